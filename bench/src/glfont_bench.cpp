@@ -0,0 +1,279 @@
+// Micro-benchmarks of text layout, measurement, vertex generation, atlas construction and buffer uploads.
+// Runs headless (see HeadlessContext) and prints the results as JSON on stdout, progress goes to stderr.
+
+#include "HeadlessContext.h"
+
+#include <GLFont/GLFont.h>
+#include <GLFont/FontAtlas.h>
+#include <GLFont/StreamBuffer.h>
+#include <GLFont/TextBatch.h>
+#include <GLFont/TextLayout.h>
+#include <GLFont/TextMeasure.h>
+#include <GLFont/Utf8.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+static const char* Paragraph =
+    "Lorem ipsum dolor sit amet, consectetur adipiscing elit. Aliquam quis pellentesque ligula, sed imperdiet "
+    "tortor. Curabitur eleifend facilisis orci, a accumsan felis hendrerit in. Duis nec fringilla quam. Proin "
+    "accumsan nulla lacus, vel posuere diam imperdiet et. Nunc sed dui pellentesque, pretium justo vel, posuere "
+    "justo. Integer mollis luctus condimentum. Vivamus quis ex quis nisl convallis ullamcorper sed a urna. "
+    "Praesent eu libero dignissim, rutrum nisi in, euismod nibh. Phasellus est felis, malesuada suscipit leo ac, "
+    "varius egestas turpis. ";
+
+static const char* Words[] = {
+    "joint_position", "velocity", "torque", "effort", "rad/s", "N\xC2\xB7m", "OK", "WARNING", "l_shoulder_pitch",
+    "r_knee", "temperature", "25.3 \xC2\xB0" "C", "battery", "connected", "idle", "running"
+};
+
+struct Options {
+    double minTime = 0.2; // seconds each benchmark runs for, at least
+    bool quick = false; // fewer fonts and sizes
+    std::string filter; // only run benchmarks whose name contains this
+};
+
+struct Result {
+    std::string name;
+    long iterations;
+    double nsPerIteration;
+    std::string unit; // what the per unit figures count, e.g. glyph or byte
+    double unitsPerIteration;
+};
+
+static Options options;
+static std::vector<Result> results;
+
+// Metrics of an atlas without its word cache, to measure layout as if every word was new
+class UncachedMetrics : public GlyphMetrics {
+public:
+    UncachedMetrics(FontAtlas* atlas) : _atlas(atlas) {}
+
+    unsigned getGlyphIndex(uint32_t codepoint) override { return _atlas->getGlyphIndex(codepoint); }
+    float getAdvanceX(unsigned index) override { return _atlas->getAdvanceX(index); }
+    float getAdvanceY(unsigned index) override { return _atlas->getAdvanceY(index); }
+    bool isBlank(unsigned index) override { return _atlas->isBlank(index); }
+    float getKerning(uint32_t left, uint32_t right) override { return _atlas->getKerning(left, right); }
+    int getPixelSize() override { return _atlas->getPixelSize(); }
+    int getLineHeight() override { return _atlas->getLineHeight(); }
+
+private:
+    FontAtlas* _atlas;
+};
+
+static bool selected(const std::string& name) {
+    return options.filter.empty() || name.find(options.filter) != std::string::npos;
+}
+
+// Call run() until the minimum time has passed, and record the mean time per call
+template<typename F>
+static void bench(const std::string& name, const std::string& unit, double unitsPerIteration, F run) {
+    if(!selected(name))
+        return;
+
+    fprintf(stderr, "%s\n", name.c_str());
+    run(); // warm up caches and lazily built state
+
+    typedef std::chrono::steady_clock Clock;
+    long iterations = 0;
+    Clock::time_point start = Clock::now();
+    double elapsed = 0;
+    do {
+        run();
+        ++iterations;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    } while(elapsed < options.minTime);
+
+    results.push_back(Result{name, iterations, elapsed * 1e9 / iterations, unit, unitsPerIteration});
+}
+
+static size_t countCodepoints(const std::string& text) {
+    size_t count = 0;
+    const char* p = text.c_str();
+    while(Utf8::next(p))
+        ++count;
+    return count;
+}
+
+static void benchLayout(const std::shared_ptr<GLFont>& font) {
+    std::string text;
+    for(int i = 0; i < 8; ++i)
+        text += Paragraph;
+    double glyphs = static_cast<double>(countCodepoints(text));
+
+    std::shared_ptr<FontAtlas> atlas(new FontAtlas(font->getFaceHandle(), 16));
+    UncachedMetrics uncached(atlas.get());
+
+    TextLayout layout;
+    layout.setMaxSize(300, 0);
+
+    // Line breaking and glyph positioning, measuring every word, then looking words up in the atlas cache
+    layout.setMetrics(&uncached);
+    bench("layout/wrap_uncached", "glyph", glyphs, [&]() { layout.layout(text); });
+    layout.setMetrics(atlas.get());
+    bench("layout/wrap_word_cache", "glyph", glyphs, [&]() { layout.layout(text); });
+
+    // Width of short single lines, the most common measurement
+    std::vector<std::string> words(Words, Words + sizeof(Words) / sizeof(Words[0]));
+    layout.setMaxSize(0, 0);
+    bench("layout/measure_words", "string", static_cast<double>(words.size()), [&]() {
+        for(const std::string& word : words)
+            layout.layout(word);
+    });
+
+    TextMeasure measure;
+    bench("measure/cached_words", "string", static_cast<double>(words.size()), [&]() {
+        for(const std::string& word : words)
+            measure.measure(word, font, 16);
+    });
+}
+
+static void benchVertices(const std::shared_ptr<GLFont>& font, HeadlessContext& context) {
+    std::string text;
+    for(int i = 0; i < 4; ++i)
+        text += Paragraph;
+    double glyphs = static_cast<double>(countCodepoints(text));
+
+    FTLabel label(font, text, 0, 0, 600, 0, context.getWidth(), context.getHeight());
+    label.setPixelSize(16);
+    TextBatch batch;
+
+    // Moving the label lays it out again and regenerates its quads, which the batch copies without drawing
+    float x = 0;
+    bench("label/layout_and_quads", "glyph", glyphs, [&]() {
+        label.setPosition(x = 1 - x, 0);
+        label.render(batch);
+        batch.clear();
+    });
+
+    // With instanced rendering, update() lays it out again and uploads one instance per glyph, without drawing
+    label.setInstancedRendering(true);
+    bench("label/layout_and_instance_upload", "glyph", glyphs, [&]() {
+        label.setPosition(x = 1 - x, 0);
+        label.update();
+    });
+}
+
+static void benchAtlases() {
+    std::vector<std::string> files;
+    for(const auto& entry : std::filesystem::recursive_directory_iterator(GLFont::DefaultFontsPathPrefix())) {
+        std::string path = entry.path().string();
+        bool regular = path.find("Regular") != std::string::npos;
+        if(entry.path().extension() == ".ttf" && (regular || !options.quick))
+            files.push_back(path);
+    }
+    std::sort(files.begin(), files.end());
+
+    std::vector<int> sizes = options.quick ? std::vector<int>{16, 48} : std::vector<int>{12, 16, 24, 48, 96};
+
+    for(const std::string& file : files) {
+        std::shared_ptr<GLFont> font(new GLFont(file));
+        std::string name = std::filesystem::path(file).stem().string();
+
+        for(int size : sizes) {
+            // Rasterization of the printable ASCII characters, and the first upload of the pages
+            bench("atlas/" + name + "/" + std::to_string(size), "atlas", 1, [&]() {
+                FontAtlas atlas(font->getFaceHandle(), size);
+                atlas.getTexId();
+                glFinish();
+            });
+        }
+    }
+}
+
+static void benchUploads() {
+    std::vector<size_t> sizes = {16 * 1024, 256 * 1024, 4 * 1024 * 1024};
+    std::vector<unsigned char> data(sizes.back(), 0x5a);
+
+    std::vector<StreamBuffer::Mode> modes = {StreamBuffer::Orphaning};
+    if(StreamBuffer::isPersistentMappingSupported())
+        modes.push_back(StreamBuffer::PersistentRing);
+
+    for(StreamBuffer::Mode mode : modes) {
+        StreamBuffer buffer(GL_ARRAY_BUFFER, mode);
+        std::string name = mode == StreamBuffer::Orphaning ? "upload/orphaning/" : "upload/persistent_ring/";
+
+        // Each upload waits for the GPU, so that the transfer is counted and not just queued
+        for(size_t size : sizes) {
+            bench(name + std::to_string(size / 1024) + "k", "byte", static_cast<double>(size), [&]() {
+                buffer.upload(data.data(), size);
+                glFinish();
+            });
+        }
+    }
+}
+
+static void printJson(HeadlessContext& context) {
+    printf("{\n");
+    printf("  \"context\": {\"vendor\": \"%s\", \"renderer\": \"%s\", \"version\": \"%s\"},\n",
+           reinterpret_cast<const char*>(glGetString(GL_VENDOR)), reinterpret_cast<const char*>(glGetString(GL_RENDERER)),
+           reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+    printf("  \"benchmarks\": [\n");
+
+    for(size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        printf("    {\"name\": \"%s\", \"iterations\": %ld, \"ns_per_iteration\": %.1f, \"unit\": \"%s\", "
+               "\"units_per_iteration\": %.0f, \"ns_per_unit\": %.3f}%s\n",
+               r.name.c_str(), r.iterations, r.nsPerIteration, r.unit.c_str(), r.unitsPerIteration,
+               r.nsPerIteration / r.unitsPerIteration, i + 1 < results.size() ? "," : "");
+    }
+
+    printf("  ]\n");
+    printf("}\n");
+}
+
+static void printUsage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "Options:\n"
+            "  --min-time <seconds>  time each benchmark runs for, at least (default 0.2)\n"
+            "  --filter <text>       only run the benchmarks whose name contains text\n"
+            "  --quick               only build the atlases of the regular faces, at two sizes\n",
+            program);
+}
+
+int main(int argc, char** argv) {
+    for(int i = 1; i < argc; ++i) {
+        if(!strcmp(argv[i], "--min-time") && i + 1 < argc) {
+            options.minTime = atof(argv[++i]);
+        }
+        else if(!strcmp(argv[i], "--filter") && i + 1 < argc) {
+            options.filter = argv[++i];
+        }
+        else if(!strcmp(argv[i], "--quick")) {
+            options.quick = true;
+        }
+        else {
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    try {
+        HeadlessContext context(1280, 720);
+
+        {
+            std::shared_ptr<GLFont> font(new GLFont(GLFont::DefaultFontsPathPrefix() + "Roboto/Roboto-Regular.ttf"));
+            benchLayout(font);
+            benchVertices(font, context);
+            benchAtlases();
+            benchUploads();
+        }
+
+        printJson(context);
+    }
+    catch(const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,76 @@
+#include "HeadlessContext.h"
+
+#include <EGL/eglext.h>
+
+#include <stdexcept>
+
+HeadlessContext::HeadlessContext(int width, int height) :
+  _width(width),
+  _height(height)
+{
+    // Prefer the surfaceless platform, which needs neither X nor a GPU
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    _display = getPlatformDisplay ? getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL)
+                                  : EGL_NO_DISPLAY;
+    if(_display == EGL_NO_DISPLAY)
+        _display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    if(_display == EGL_NO_DISPLAY || !eglInitialize(_display, NULL, NULL))
+        throw std::runtime_error("Failed to initialize EGL");
+
+    eglBindAPI(EGL_OPENGL_API);
+
+    EGLint configAttributes[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+    EGLConfig config = NULL;
+    EGLint configCount = 0;
+    eglChooseConfig(_display, configAttributes, &config, 1, &configCount);
+
+    EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    _context = eglCreateContext(_display, configCount ? config : NULL, EGL_NO_CONTEXT, contextAttributes);
+    if(_context == EGL_NO_CONTEXT || !eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, _context))
+        throw std::runtime_error("Failed to create an OpenGL 3.3 context");
+
+    glewExperimental = true;
+    GLenum error = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    // GLEW 2.2 built for GLX complains that there is no X display, after loading the core functions
+    if(error == GLEW_ERROR_NO_GLX_DISPLAY)
+        error = GLEW_OK;
+#endif
+    if(error != GLEW_OK)
+        throw std::runtime_error("Failed to initialize GLEW");
+
+    glGenFramebuffers(1, &_framebuffer);
+    glGenRenderbuffers(1, &_colorBuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+    resize(width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _colorBuffer);
+}
+
+HeadlessContext::~HeadlessContext() {
+    glDeleteFramebuffers(1, &_framebuffer);
+    glDeleteRenderbuffers(1, &_colorBuffer);
+
+    eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(_display, _context);
+    eglTerminate(_display);
+}
+
+void HeadlessContext::resize(int width, int height) {
+    _width = width;
+    _height = height;
+
+    glBindRenderbuffer(GL_RENDERBUFFER, _colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, _width, _height);
+    glViewport(0, 0, _width, _height);
+}
+
+void HeadlessContext::bindFramebuffer() {
+    glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+}
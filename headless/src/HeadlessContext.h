@@ -0,0 +1,33 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <EGL/egl.h>
+
+// OpenGL 3.3 core context without any window or display, through EGL (surfaceless Mesa, e.g. llvmpipe, on machines
+// without a GPU). Drawing goes to an offscreen framebuffer of the given size. Shared by the benchmarks and the
+// stress scene
+class HeadlessContext {
+public:
+    // Create the context, make it current and bind the framebuffer. Throws std::runtime_error on failure
+    HeadlessContext(int width, int height);
+    ~HeadlessContext();
+
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    // Reallocate the framebuffer and update the viewport
+    void resize(int width, int height);
+    // Draw into the offscreen framebuffer again, e.g. after drawing into another framebuffer
+    void bindFramebuffer();
+
+    inline int getWidth() { return _width; }
+    inline int getHeight() { return _height; }
+
+private:
+    EGLDisplay _display;
+    EGLContext _context;
+    GLuint _framebuffer;
+    GLuint _colorBuffer;
+    int _width;
+    int _height;
+};
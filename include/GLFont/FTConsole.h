@@ -0,0 +1,99 @@
+#ifndef GLFONT_FTCONSOLE_H
+#define GLFONT_FTCONSOLE_H
+
+#include <GLFont/FTLabel.h>
+
+#include <deque>
+#include <memory>
+#include <string>
+
+// Scrolling log of text lines, laid out like a paragraph label. Appending a line only lays out and uploads that
+// line: glyph quads are kept in a GPU ring buffer, which overwrites the oldest lines, and scrolling only moves
+// the view. The console always draws quads, through render(), and setText() does not apply
+class FTConsole : public FTLabel {
+public:
+    // Console showing as many lines as fit in a box of width x height pixels at (x, y), in window coordinates.
+    // Lines wider than the box are wrapped, a height of 0 shows every line
+    FTConsole(std::shared_ptr<GLFont> ftFace, float x, float y, int width, int height, int windowWidth, int windowHeight);
+    ~FTConsole();
+
+    // Add lines at the bottom. Text with newlines is added as several lines.
+    // If the view was at the bottom, it scrolls to show the new lines
+    void appendLine(const std::string& text);
+    void clear();
+
+    // Number of lines kept, older lines are dropped
+    void setMaxLines(size_t lines);
+    size_t getMaxLines();
+    size_t getLineCount();
+
+    // Scrolling is counted in rows, the lines once wrapped. Row 0 is the oldest row kept
+    void scroll(int rows); // negative values scroll up, towards older rows
+    void scrollTo(size_t row); // first visible row
+    void scrollToBottom();
+    size_t getScrollRow();
+    size_t getRowCount();
+
+    void update() override;
+    void render() override;
+    // Draws right away, as only the ring buffer holds the quads of every line. The labels already queued are drawn
+    // first, so that the console still comes out on top of them
+    void render(TextBatch& batch) override;
+
+private:
+    static const size_t MinRingVertices = 6 * 1024;
+    // Distance from the base row after which new lines start a new one, in pixels. Floats place glyphs within
+    // 1/500 pixel at that distance
+    static const int MaxRowOffset = 1 << 14;
+
+    struct Line {
+        std::string text;
+        size_t rows;
+        // Vertices of the line in the ring buffer
+        size_t firstVertex;
+        size_t vertexCount;
+    };
+
+    struct Row {
+        GLint first;
+        GLsizei count;
+        size_t base; // row its quads were laid out relative to
+    };
+
+    std::deque<Line> _lines;
+    std::deque<Row> _rows;
+    size_t _maxLines;
+
+    // Rows are numbered from the first row ever appended. Vertices are laid out relative to the base row of their
+    // row, and moved to the scroll position by the MVP matrix
+    size_t _firstRow; // number of _rows.front()
+    size_t _baseRow; // base row of the lines laid out next
+    size_t _scrollRow; // first visible row
+    bool _followTail; // keep the last rows visible when lines are added
+
+    GLuint _ringVao;
+    GLuint _ringBuffer;
+    size_t _ringCapacity; // in vertices
+    size_t _ringHead; // next vertex to write
+
+    // Lay out every line again if a setter changed the layout
+    void updateLayout() override;
+    bool hasParallelLayout() override { return false; }
+
+    // Height of a row, in window pixels
+    float rowHeight();
+    size_t visibleRows();
+    size_t bottomRow();
+
+    // Wrap a line and position its glyphs starting at the given row, relative to _baseRow, adding its quads to
+    // _coords and its rows to _rows. Returns the number of rows
+    size_t layoutLine(const std::string& text, size_t row);
+    // Write the quads of a new line into the ring, dropping the oldest lines it overwrites
+    void writeLine(Line& line);
+    void dropFirstLine();
+    // Lay out every line again and rewrite the ring from the start, growing it to at least capacity vertices
+    void rebuild(size_t capacity = 0);
+    void allocateRing(size_t capacity);
+};
+
+#endif //GLFONT_FTCONSOLE_H
@@ -0,0 +1,54 @@
+#ifndef GLFONT_FTFIELDLABEL_H
+#define GLFONT_FTFIELDLABEL_H
+
+#include <GLFont/FTLabel.h>
+
+#include <memory>
+#include <vector>
+
+// Single line label with a fixed number of character slots, for values that change every frame (e.g. telemetry).
+// Values are formatted on the stack and right-aligned in the slots, which all have the width of the widest digit
+// so that numbers do not jitter. Only the quads of the slots that changed are uploaded, and updates never allocate.
+// The field always draws quads, through render(), and setText() does not apply
+class FTFieldLabel : public FTLabel {
+public:
+    static const int MaxSlots = 32;
+
+    // Field of the given number of slots (at most MaxSlots) at (x, y), in window coordinates. The alignment of the
+    // label positions the whole field around x
+    FTFieldLabel(std::shared_ptr<GLFont> ftFace, float x, float y, int slots, int windowWidth, int windowHeight);
+    ~FTFieldLabel();
+
+    // Show a value with the given number of decimals. Values not fitting in the slots show as ###
+    void setNumber(double value, int precision = 2);
+    void setNumber(long value);
+    // Show a short ASCII text, e.g. "N/A"
+    void setField(const char* text);
+
+    inline int getSlotCount() { return _slotCount; }
+
+    void update() override;
+    void render() override;
+    // Draws right away, as only the field buffer holds the quads of every slot. The labels already queued are drawn
+    // first, so that the field still comes out on top of them
+    void render(TextBatch& batch) override;
+
+private:
+    int _slotCount;
+    std::vector<char> _slots; // characters to show, a space for empty slots
+    std::vector<char> _uploaded; // characters of the quads in the buffer, 0 if the slot has to be written
+
+    float _slotWidth; // in window pixels
+    float _originX; // left edge of the field, in window pixels
+
+    GLuint _fieldVao;
+    GLuint _fieldBuffer; // 6 vertices per slot, empty slots hold degenerate quads
+
+    // Position the slots again if a setter changed the layout
+    void updateLayout() override;
+    bool hasParallelLayout() override { return false; }
+    // Write the quads of the slots whose character changed, in a single upload
+    void uploadSlots();
+};
+
+#endif //GLFONT_FTFIELDLABEL_H
@@ -5,14 +5,23 @@
 #include <cmath>
 
 #include <GLFont/GLConfig.h>
+#include <GLFont/FontAtlas.h>
+#include <GLFont/Statistics.h>
+#include <GLFont/StreamBuffer.h>
+#include <GLFont/TextLayout.h>
 
+#include <future>
 #include <memory> // for use of shared_ptr
 #include <map>
 #include <vector>
 #include <string>
+#include <string_view>
 
-class FontAtlas;
+class FontFamily;
 class GLFont;
+class LayoutPool;
+class ShaderProgram;
+class TextBatch;
 
 class FTLabel {
 public:
@@ -22,7 +31,7 @@ public:
         CenterAligned    = 1 << 3,
         WordWrap         = 1 << 4,
         Underlined       = 1 << 5,
-        Bold             = 1 << 6,
+        Bold             = 1 << 6, // Bold and Italic select the face of the font family, if the label has one
         Italic           = 1 << 7,
         Indented         = 1 << 8,
         HorizontalLayout = 1 << 9
@@ -33,7 +42,11 @@ public:
     FTLabel(GLFont* ftFace, int windowWidth, int windowHeight);
     FTLabel(std::shared_ptr<GLFont> ftFace, const std::string& text, float x, float y, int maxWidth, int maxHeight, int windowWidth, int windowHeight);
     FTLabel(std::shared_ptr<GLFont> ftFace, const std::string& text, float x, float y, int windowWidth, int windowHeight);
-    ~FTLabel();
+    // Draw from an atlas loaded with FontAtlas::load(), without any FreeType face
+    FTLabel(std::shared_ptr<FontAtlas> fontAtlas, int windowWidth, int windowHeight);
+    // Draw with the face of the family matching the Bold and Italic flags
+    FTLabel(std::shared_ptr<FontFamily> fontFamily, int windowWidth, int windowHeight);
+    virtual ~FTLabel();
 
     void setWindowSize(int width, int height);
 
@@ -46,7 +59,13 @@ public:
     void setText(const std::string &text);
     void setPosition(float x, float y);
     void setMaxSize(int width, int height);
-    void setFont(std::shared_ptr<GLFont> ftFace);
+    void setFont(std::shared_ptr<GLFont> ftFace); // the label no longer uses its font family, if any
+    // Draw with the face of the family matching the Bold and Italic flags, which is switched when the flags change.
+    // Characters the face does not have are taken from the fallback faces of the family
+    void setFontFamily(std::shared_ptr<FontFamily> fontFamily);
+    // Use a fixed atlas (e.g. loaded with FontAtlas::load()) instead of a face. The pixel size is reset to the size
+    // of the atlas, other sizes scale its glyphs, which only looks sharp with distance field atlases
+    void setFontAtlas(std::shared_ptr<FontAtlas> fontAtlas);
     void setColor(float r, float b, float g, float a); // RGBA values are 0 - 1.0
     void setAlignment(FontFlags alignment);
     void setPixelSize(int size);
@@ -54,6 +73,15 @@ public:
     void setFontFlags(int flags);
     void setFontAspectRatio(float aspectRatio);
     void appendFontFlags(int flags);
+    // Draw one instance per glyph, expanded into a quad on the GPU from the glyph metrics stored in the atlas.
+    // This sends 12 bytes per glyph instead of 96, which pays off for long texts
+    void setInstancedRendering(bool enabled);
+    // Draw from a distance field atlas shared by every pixel size of the face (see FontAtlas::DistanceFieldSize),
+    // which stays sharp when the label is scaled or rotated. Bitmap atlases look better at small, fixed sizes
+    void setRenderMode(FontAtlas::RenderMode mode); // the render mode of a fixed atlas cannot be changed
+    // Build the atlases of new pixel sizes on a worker thread. Meanwhile the label draws with the closest size
+    // already available, scaled. Only the first atlas of a face and render mode is waited for
+    void setAsyncAtlasBuilding(bool enabled);
 
     // Getters
     std::string getText();
@@ -62,6 +90,7 @@ public:
     int getWidth();
     int getHeight();
     char* getFont();
+    std::shared_ptr<FontFamily> getFontFamily();
     glm::vec4 getColor();
     FontFlags getAlignment();
     float getRotation();
@@ -69,31 +98,68 @@ public:
     int getFontFlags();
     int getCurrentLabelHeight();
     int getCurrentLabelWidth();
-
-    void render();
-
-private:
+    bool getInstancedRendering();
+    FontAtlas::RenderMode getRenderMode();
+    bool getAsyncAtlasBuilding();
+
+    // Work done for this label since it was created or since resetStatistics(). Atlases are shared between labels,
+    // so the atlas counters are only kept globally (see Statistics)
+    const Statistics::Counters& getStatistics();
+    void resetStatistics();
+    // Time render() on the GPU with timer queries. Results are read back once available instead of waiting for
+    // the GPU, so they lag a frame or two behind
+    void setGpuTiming(bool enabled);
+    bool getGpuTiming();
+    // GPU time of the last timed render() whose result came back, in milliseconds
+    double getGpuTime();
+
+    // Lay out and upload the changes made since the last update, without drawing. render() does it otherwise,
+    // this is for doing it ahead of the draw pass (e.g. to time it)
+    virtual void update();
+    virtual void render();
+    // Queue the label into a batch instead of drawing it. The batch issues the draw calls.
+    // Labels whose quads only live in their own GL buffer draw themselves right away instead
+    virtual void render(TextBatch& batch);
+
+protected:
+    friend class TextBatch;
+    friend class LayoutPool;
 
     struct Point {
         GLfloat x{0.0}; // x offset in window coordinates
         GLfloat y{0.0}; // y offset in window coordinates
         GLfloat s{0.0}; // glyph x offset in texture coordinates
         GLfloat t{0.0}; // glyph y offset in texture coordinates
+        GLfloat layer{0.0}; // atlas page holding the glyph
 
         Point() {}
 
-        Point(float x, float y, float s, float t) :
-            x(x), y(y), s(s), t(t) {}
+        Point(float x, float y, float s, float t, float layer) :
+            x(x), y(y), s(s), t(t), layer(layer) {}
+    };
+
+    struct GlyphInstance {
+        GLfloat x{0.0}; // x pen position in normalized coordinates
+        GLfloat y{0.0}; // y pen position (baseline) in normalized coordinates
+        GLuint index{0}; // index of the glyph in the atlas
+
+        GlyphInstance() {}
+
+        GlyphInstance(float x, float y, GLuint index) :
+            x(x), y(y), index(index) {}
     };
 
     std::shared_ptr<GLFont> _ftFace;
     FT_Face _face;
+    std::shared_ptr<FontFamily> _fontFamily; // if set, _ftFace is the face of the family matching _flags
+    std::vector<FT_Face> _fallbackFaces; // fallback faces of the family, part of the atlas key
     FT_Error _error;
     FT_GlyphSlot _g;
 
-    GLuint _programId;
+    std::shared_ptr<ShaderProgram> _program; // shared by all labels of the context
+    std::shared_ptr<ShaderProgram> _instancedProgram; // only loaded once instanced rendering is enabled
     GLuint _vao;
-    GLuint _vbo;
+    StreamBuffer _vertexBuffer;
 
     GLint _uniformTextureHandle;
     GLint _uniformTextColorHandle;
@@ -101,13 +167,34 @@ private:
 
     std::string _text;
 
-    std::vector<Point> _coords;
+    // Lines and glyph positions of the text, in window pixels. The layout itself does not touch GL
+    TextLayout _layout;
 
-    // Holds texture atlases for different character pixel sizes
-    std::map<int, std::shared_ptr<FontAtlas>> _fontAtlas;
+    std::vector<GlyphInstance> _glyphs; // positioned glyphs, output of the layout
+    std::vector<Point> _coords; // quads built from _glyphs, when not using instanced rendering
+
+    // Texture atlas for the current face and pixel size, shared with other labels through FontAtlasCache
+    std::shared_ptr<FontAtlas> _fontAtlas;
+    FontAtlas::RenderMode _renderMode;
+    float _glyphScale; // label pixels per atlas pixel, 1 unless the atlas is a distance field or a stand-in
+    bool _asyncAtlas;
+    std::shared_future<std::shared_ptr<FontAtlas>> _pendingAtlas; // atlas of the pixel size, being built
 
     int _flags; // Currently enabled settings set via FontFlags
     size_t _numVertices;
+    GLint _firstVertex; // position of the label vertices in _vertexBuffer
+    // Buffer and first instance recorded in _vao: instanced draws have no first instance parameter in GL 3.3
+    GLuint _vaoBuffer;
+    GLint _vaoFirstInstance;
+    bool _instanced;
+
+    // What needs to be recomputed before the label is measured or drawn
+    enum DirtyFlags {
+        LayoutDirty = 1 << 0, // text must be wrapped and glyphs positioned again
+        QuadsDirty  = 1 << 1, // glyph quads must be regenerated from the positioned glyphs
+        BufferDirty = 1 << 2  // vertices must be uploaded to the vertex buffer
+    };
+    int _dirty;
 
     // Window dimensions
     int _windowWidth;
@@ -149,6 +236,16 @@ private:
 
     bool _isInitialized;
 
+    Statistics::Counters _statistics;
+
+    // Timer queries used in turn, so that a query is read at least NumTimerQueries - 1 renders after it was issued
+    static const int NumTimerQueries = 3;
+    bool _gpuTiming;
+    GLuint _timerQueries[NumTimerQueries];
+    bool _timerPending[NumTimerQueries];
+    int _timerQuery; // next query to issue
+    double _gpuTime; // milliseconds
+
     // Used for debugging opengl only
     inline void getError() {
         const GLubyte* error = gluGetString(glGetError());
@@ -156,19 +253,53 @@ private:
             printf("----------------------------- %s ----------------------", error);
     }
 
+    // Count work done for the label, globally too
+    inline void count(Statistics::Counter counter, int64_t value = 1) {
+        _statistics.values[counter] += value;
+        Statistics::add(counter, value);
+    }
+
+    // Wrap the draw calls of render(), if GPU timing is enabled
+    void beginGpuTimer();
+    void endGpuTimer();
+
     // Compile shader from file
     void loadShader(char* shaderSource, GLenum shaderType);
-    // Split text into words separated by spaces
-    std::vector<std::string> splitText(const std::string &text);
-    // Returns the width (in pixels) of the string, given the current pixel size
-    int calcWidth(const char* text);
-
+    // Bring the settings of the layout up to date with those of the label
+    void setupLayout(int maxWidth, int maxHeight);
     // Calculate vertices for a paragraph label
-    void recalculateVertices(const std::string &text, float x, float y, int maxWidth, int maxHeight);
-    // Calculate vertices without regards to width or height boundaries
-    void recalculateVertices(const char* text, float x, float y);
+    void recalculateVertices(std::string_view text, float x, float y, int maxWidth, int maxHeight);
+    // Append glyphs of the layout to _glyphs, in normalized coordinates
+    void placeGlyphs(size_t firstGlyph, size_t endGlyph);
+    // Expand the positioned glyphs into two triangles each
+    void recalculateQuads();
+    // Append the two triangles of a positioned glyph to _coords
+    void appendQuad(const GlyphInstance& glyph);
 
     void recalculateMVP();
+
+    // Switch to the face of the family matching the Bold and Italic flags, if it changed
+    void updateFamilyFont();
+
+    // Setters only mark the label dirty; layout and upload are committed lazily by these
+    virtual void updateLayout();
+    // Switch to the pending atlas once it has been built
+    void updateAtlas();
+    void updateQuads();
+    void updateBuffer();
+
+    // Lay out and build the quads, without updating the atlas or touching GL, for LayoutPool. Every glyph of the
+    // text must already be in the atlas
+    void updateGeometry();
+    // Whether updateGeometry() is all the layout of the label needs. Labels whose layout writes to GL buffers
+    // return false, and are laid out on the GL thread
+    virtual bool hasParallelLayout() { return true; }
+
+    // Get the shared programs matching the render mode, loading the instanced one only if needed
+    void loadPrograms();
+    // Record the vertex layout in _vao, with the per-glyph attributes starting at _firstVertex of the current buffer
+    void setupVertexArray();
+    void renderInstanced();
 };
 
 #endif //GLFONT_FTLABEL_H
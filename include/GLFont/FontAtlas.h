@@ -2,40 +2,259 @@
 #define GLFONT_FONTATLAS_H
 
 #include <GLFont/GLConfig.h>
+#include <GLFont/FontRegistry.h>
+#include <GLFont/GlyphMetrics.h>
+#include <GLFont/WordCache.h>
 
-class FontAtlas {
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class MappedFile;
+
+// Glyphs of a face at one pixel size, rasterized into GL textures. Final so that calls through FontAtlas pointers
+// skip the GlyphMetrics virtual dispatch
+class FontAtlas final : public GlyphMetrics {
 public:
+    enum RenderMode {
+        Bitmap,       // 8-bit antialiased coverage
+        DistanceField // 8-bit signed distance to the outline, 0.5 on the edge. Scales to any pixel size
+    };
+
+    // Pixel size distance field atlases should be rasterized at. A single atlas of this size serves
+    // labels of every pixel size
+    static const int DistanceFieldSize = 64;
+
     struct Character {
-        float advanceX;
-        float advanceY;
+        float advanceX{0.0};
+        float advanceY{0.0};
+
+        float bitmapWidth{0.0};
+        float bitmapHeight{0.0};
 
-        float bitmapWidth;
-        float bitmapHeight;
+        float bitmapLeft{0.0};
+        float bitmapTop{0.0};
 
-        float bitmapLeft;
-        float bitmapTop;
+        // Position of the glyph in texture coordinates
+        float xOffset{0.0};
+        float yOffset{0.0};
 
-        float xOffset;
+        // Size of the glyph in texture coordinates
+        float uvWidth{0.0};
+        float uvHeight{0.0};
+
+        int page{0}; // layer of the atlas texture array holding the glyph
     };
 
-    FontAtlas(FT_Face face, int pixelSize);
+    // The printable ASCII characters are rasterized upfront, any other codepoint the first time it is used.
+    // Codepoints the face does not have are taken from the first fallback face that has them, if any.
+    // Faces opened through FontRegistry are kept open by the atlas, other faces must outlive it
+    FontAtlas(FT_Face face, int pixelSize, RenderMode mode = Bitmap,
+              const std::vector<FT_Face>& fallbacks = std::vector<FT_Face>());
     ~FontAtlas();
 
-    inline GLuint getTexId() { return _tex; }
-    inline int getAtlasWidth() { return _width; }
-    inline int getAtlasHeight() { return _height; }
-    inline Character* getCharInfo() { return _chars; }
+    // Prefer FontAtlasCache::get() over constructing atlases directly, so that identical atlases are shared
+
+    // Build an atlas with its own copy of the face, so that it can run on any thread while the face is used
+    // elsewhere. The copies read the font data of the faces, which the atlas keeps open for its whole life to
+    // rasterize glyphs on demand. Returns null if a face cannot be reopened
+    static std::shared_ptr<FontAtlas> build(std::shared_ptr<FontRegistry::Face> face, int pixelSize, RenderMode mode = Bitmap,
+                                            const std::vector<std::shared_ptr<FontRegistry::Face>>& fallbacks =
+                                                std::vector<std::shared_ptr<FontRegistry::Face>>());
+
+    // Write the glyphs rasterized so far, with their metrics and kerning, to a binary atlas file.
+    // Does not need a GL context. Throws std::runtime_error if the file cannot be written
+    void save(const std::string& path);
+    // Map an atlas file written by save(). The pages are uploaded straight from the mapping, without FreeType.
+    // Codepoints that were not baked show as .notdef. Throws std::runtime_error if the file is not a valid atlas
+    static std::shared_ptr<FontAtlas> load(const std::string& path);
+
+    // Glyphs are rasterized into a CPU copy of the atlas and only sent to the GPU by these getters,
+    // which must therefore be called from the thread owning the GL context
+
+    // GL_TEXTURE_2D_ARRAY with one layer per page
+    GLuint getTexId();
+    // Texture buffer holding the metrics of every glyph, three RGBA32F texels per glyph:
+    // (bitmapLeft, bitmapTop, bitmapWidth, bitmapHeight) in pixels, (left, top, right, bottom) texture coordinates
+    // and (page, 0, 0, 0)
+    GLuint getGlyphMetricsTexId();
+
+    // Glyphs are packed into square pages, all of the same power of two size
+    inline int getAtlasWidth() { return _pageSize; }
+    inline int getAtlasHeight() { return _pageSize; }
+    inline int getPageCount() { return static_cast<int>(_pages.size()); }
+
+    // Index of the glyph for a codepoint, rasterizing it into the atlas if needed.
+    // Codepoints neither the face nor its fallbacks have map to the .notdef glyph of the face
+    inline unsigned getGlyphIndex(uint32_t codepoint) override {
+        if(codepoint < AsciiCount)
+            return codepoint; // ASCII glyphs are stored at the index of their codepoint
+
+        return lookupGlyph(codepoint);
+    }
+
+    // Whether getGlyphIndex() has the codepoint already, i.e. will not add a glyph to the atlas
+    inline bool hasGlyph(uint32_t codepoint) { return codepoint < AsciiCount || _glyphIndices.count(codepoint); }
+
+    // Rasterize the glyphs of many codepoints at once, spread over several threads. Codepoints already in the atlas
+    // are skipped. Worth it for large character sets, e.g. before baking or displaying CJK text
+    void preload(const std::vector<uint32_t>& codepoints);
+
+    // Metrics of a glyph. Note: the reference is invalidated when new glyphs are added to the atlas
+    inline const Character& getCharacter(unsigned index) { return _glyphs[index]; }
+    inline float getAdvanceX(unsigned index) override { return _glyphs[index].advanceX; }
+    inline float getAdvanceY(unsigned index) override { return _glyphs[index].advanceY; }
+    inline bool isBlank(unsigned index) override { return !_glyphs[index].bitmapWidth || !_glyphs[index].bitmapHeight; }
+
+    // Horizontal kerning, in pixels, to add to the advance of left when followed by right.
+    // Glyphs taken from fallback faces are not kerned. Unlike the other getters, safe to call from several threads
+    // at once
+    inline float getKerning(uint32_t left, uint32_t right) override {
+        if(!_hasKerning)
+            return 0;
+
+        if(left >= FirstChar && left < AsciiCount && right >= FirstChar && right < AsciiCount)
+            return _kerning[(left - FirstChar) * (AsciiCount - FirstChar) + (right - FirstChar)];
+
+        if(!left || !right)
+            return 0;
+
+        return lookupKerning(left, right);
+    }
+
+    inline int getPixelSize() override { return _pixelSize; }
+    inline RenderMode getRenderMode() { return _renderMode; }
+    // Distance between two baselines, in pixels
+    inline int getLineHeight() override { return _lineHeight; }
+    // Words laid out by the labels sharing the atlas
+    inline WordCache* getWordCache() override { return &_wordCache; }
 
 private:
+    // ASCII characters, rasterized at construction. Control characters below FirstChar are left empty
+    static const uint32_t FirstChar = 32;
+    static const uint32_t AsciiCount = 128;
+
+    static const size_t GlyphsPerWorker = 24; // smallest share of glyphs worth starting a rasterization thread for
+    static const int DistanceFieldSpread = 8; // FreeType's default, in pixels
+    static const int Padding = 2; // blank pixels between glyphs, reduces texture bleeding with antialiasing
+    static const int MinPageSize = 256;
+    static const int MaxPageSize = 2048; // safe on every GL 3.3 driver we know of
+
     FT_Face _face;
     FT_GlyphSlot _slot;
+    FT_Library _library; // owns _face if the atlas was built with its own copy of the face
+    std::vector<FT_Face> _fallbacks; // probed in order for codepoints _face does not have
+    // Registry faces the glyphs are read from, main face first: those of _face and _fallbacks, or the faces they
+    // were copied from by build()
+    std::vector<std::shared_ptr<FontRegistry::Face>> _sources;
     GLuint _tex;
+    GLuint _metricsBuffer;
+    GLuint _metricsTex;
+    // GL memory held by _tex and _metricsBuffer, counted in Statistics::AtlasTextureBytes
+    int64_t _textureBytes;
+    int64_t _metricsBytes;
+
+    // Glyph metrics, indexed by glyph index
+    std::vector<Character> _glyphs;
+    // Glyph index of the non-ASCII codepoints rasterized so far
+    std::unordered_map<uint32_t, unsigned> _glyphIndices;
+    unsigned _notdefIndex; // glyph shown for missing codepoints, 0 until first needed
+    // Codepoints taken from a fallback face, with 1 + the index of the face in _fallbacks. The face of each codepoint
+    // is only searched for once, when its glyph is rasterized
+    std::unordered_map<uint32_t, int> _fallbackCodepoints;
+
+    // Dense kerning table for every pair of ASCII characters, and cache of the other pairs looked up so far
+    bool _hasKerning;
+    std::vector<float> _kerning;
+    std::unordered_map<uint64_t, float> _kerningCache;
+    std::mutex _kerningMutex; // labels laid out in parallel share the cache
+    // Lock of _face if it is a registry face, which atlases of other sizes use too, possibly from other threads
+    std::mutex* _faceMutex;
+
+    WordCache _wordCache;
+
+    // Glyphs are packed in rows (shelves) of similar height, filled left to right and stacked top to bottom
+    struct Shelf {
+        int y;
+        int height;
+        int width; // used width
+    };
+
+    struct Page {
+        std::vector<unsigned char> pixels; // CPU copy of the texture layer
+        const unsigned char* baked; // read-only pixels of a loaded atlas, used instead of pixels if not null
+        std::vector<Shelf> shelves;
+        int height; // used height
+
+        // Range of rows with glyphs not uploaded yet
+        int uploadBegin;
+        int uploadEnd;
+    };
 
-    Character _chars[128];
+    std::vector<Page> _pages;
+    int _pageSize;
+    std::shared_ptr<MappedFile> _file; // file the atlas was loaded from, if any
 
-    int _width;  // width of texture
-    int _height; // height of texture
+    // Pending GPU updates
+    bool _textureDirty; // the texture must be reallocated (e.g. pages were added) and uploaded entirely
+    bool _uploadPending; // some pages have rows waiting to be uploaded
+    bool _metricsDirty;
+
+    int _pixelSize;
+    RenderMode _renderMode;
+    int _lineHeight;
+
+    // Empty atlas, filled by load()
+    FontAtlas();
+
+    // Make sure a shared face is set to our pixel size before asking FreeType for sized data
+    void selectSize(FT_Face face);
+    // Hold the lock of _face, if it has one, while calling FreeType with it
+    inline std::unique_lock<std::mutex> lockFace() {
+        return _faceMutex ? std::unique_lock<std::mutex>(*_faceMutex) : std::unique_lock<std::mutex>();
+    }
+
+    // Face numbers used by GlyphBitmap and _fallbackCodepoints: 0 for _face, 1 + i for _fallbacks[i]
+    inline FT_Face getFace(int face) { return face ? _fallbacks[face - 1] : _face; }
+    // Glyph index of a codepoint in the first face having it, and the number of that face. 0 if none has it
+    FT_UInt findGlyph(uint32_t codepoint, int& face);
+
+    unsigned lookupGlyph(uint32_t codepoint);
+    float lookupKerning(uint32_t left, uint32_t right);
+    // Kerning of a pair of glyph indices, rounded to whole pixels unless the atlas is meant to be scaled
+    float kerning(FT_UInt left, FT_UInt right);
+
+    // Bitmap and metrics of a glyph, rendered but not placed in the atlas yet
+    struct GlyphBitmap {
+        FT_UInt glyphIndex{0};
+        int face{0}; // face the glyph index belongs to, see getFace()
+        uint32_t codepoint{0};
+        bool loaded{false};
+        Character metrics; // texture placement left empty
+        std::vector<unsigned char> pixels; // bitmapWidth x bitmapHeight, tightly packed
+    };
+
+    // Rasterize a glyph of one of the faces and store its bitmap and metrics in c
+    bool rasterize(int face, FT_UInt glyphIndex, Character& c);
+    // Render a glyph with the given face. Does not touch the atlas, so it can run on any thread owning the face
+    static bool renderGlyph(FT_Face face, RenderMode mode, GlyphBitmap& glyph);
+    // Pack a rendered glyph into the pages and store its metrics in c
+    bool storeGlyph(const GlyphBitmap& glyph, Character& c);
+    // Render glyphs in parallel, each worker thread with its own FreeType library and faces
+    void renderGlyphs(std::vector<GlyphBitmap>& glyphs);
+    // Open the face of source again in another library, sharing the font data when possible
+    static FT_Face openFace(FT_Library library, FT_Face source);
+    // Find room for a bitmap of the given size, adding a page if needed. Returns false if it can never fit
+    bool allocate(int width, int height, int& page, int& x, int& y);
+    void addPage();
+    // Send every page to the texture through a pixel buffer. Returns false if the buffer could not be used
+    bool uploadPages();
+
+    // Query FreeType once for every pair of ASCII characters, so that layout never has to
+    void buildKerningTable();
 };
 
 #endif //GLFONT_FONTATLAS_H
-
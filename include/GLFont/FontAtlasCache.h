@@ -0,0 +1,70 @@
+#ifndef GLFONT_FONTATLASCACHE_H
+#define GLFONT_FONTATLASCACHE_H
+
+#include <GLFont/GLConfig.h>
+#include <GLFont/FontAtlas.h>
+
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+// Process-wide cache of font atlases, so that labels using the same faces and pixel size share
+// a single rasterization and a single texture. Entries are reference counted through the
+// returned shared_ptr: an atlas is freed as soon as the last label holding it drops it.
+class FontAtlasCache {
+public:
+    // Returns the atlas for the given face, pixel size, render mode and fallback faces, creating it if needed
+    static std::shared_ptr<FontAtlas> get(FT_Face face, int pixelSize, FontAtlas::RenderMode mode = FontAtlas::Bitmap,
+                                          const std::vector<FT_Face>& fallbacks = std::vector<FT_Face>());
+
+    // Same as get(), but builds missing atlases on a worker thread with FontAtlas::build(). Requests for an atlas
+    // already being built share the build. The future holds null if the build failed.
+    // Only faces opened through FontRegistry, which the build keeps open, are built asynchronously. The atlases
+    // of other faces are built before returning
+    static std::shared_future<std::shared_ptr<FontAtlas>> getAsync(FT_Face face, int pixelSize,
+                                                                   FontAtlas::RenderMode mode = FontAtlas::Bitmap,
+                                                                   const std::vector<FT_Face>& fallbacks = std::vector<FT_Face>());
+
+    // Returns the existing atlas for the given faces and render mode with the pixel size closest to pixelSize,
+    // or null if there is none. Never builds an atlas
+    static std::shared_ptr<FontAtlas> getNearest(FT_Face face, int pixelSize, FontAtlas::RenderMode mode = FontAtlas::Bitmap,
+                                                 const std::vector<FT_Face>& fallbacks = std::vector<FT_Face>());
+
+    // Number of atlases currently alive
+    static size_t size();
+
+    // Wait for the builds started by getAsync() to finish. Done at exit too, before the statics they use are destroyed
+    static void shutdown();
+
+private:
+    // Faces are identified by their registry id, as the address of a closed face can be reused by the next face
+    // opened. Faces from outside the registry have id 0 and are identified by address
+    typedef std::pair<uint64_t, FT_Face> FaceKey;
+    typedef std::tuple<FaceKey, int, FontAtlas::RenderMode, std::vector<FaceKey>> Key;
+
+    typedef std::shared_future<std::shared_ptr<FontAtlas>> Future;
+
+    static std::map<Key, std::weak_ptr<FontAtlas>> _atlases;
+    static std::map<Key, Future> _pending; // atlases being built by getAsync()
+
+    struct Build {
+        Future future;
+        std::thread thread;
+    };
+    static std::list<Build> _builds; // threads of getAsync(), joined once their atlas is ready
+    static std::mutex _mutex;
+
+    // Move the finished builds into _atlases, and join their threads. The mutex must be held
+    static void collect();
+
+    // Key of the atlas, and the registry faces of face and fallbacks (null for faces from outside the registry)
+    static Key makeKey(FT_Face face, int pixelSize, FontAtlas::RenderMode mode, const std::vector<FT_Face>& fallbacks,
+                       std::vector<std::shared_ptr<FontRegistry::Face>>& sources);
+};
+
+#endif //GLFONT_FONTATLASCACHE_H
@@ -0,0 +1,46 @@
+#ifndef GLFONT_FONTFAMILY_H
+#define GLFONT_FONTFAMILY_H
+
+#include <GLFont/GLConfig.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class GLFont;
+
+// The styles of a typeface, e.g. Roboto-Regular, Roboto-Bold and Roboto-Italic, and the fallback faces drawing
+// the characters they do not have. Labels using a family pick the face matching their Bold and Italic flags.
+class FontFamily {
+public:
+    enum Style {
+        Regular    = 0,
+        Bold       = 1 << 0,
+        Italic     = 1 << 1,
+        BoldItalic = Bold | Italic
+    };
+
+    FontFamily(std::shared_ptr<GLFont> regular);
+    // Family of the files named <name>-Regular.ttf, <name>-Bold.ttf, <name>-Italic.ttf and <name>-BoldItalic.ttf
+    // in the directory, e.g. ("fonts/Roboto", "Roboto"). Only the regular style is required, a std::runtime_error
+    // is thrown if it cannot be opened
+    FontFamily(const std::string& directory, const std::string& name);
+
+    void setFont(Style style, std::shared_ptr<GLFont> font);
+    // Font of the style, or of the closest style the family has: bold italic falls back to bold, then italic,
+    // and every style to regular
+    std::shared_ptr<GLFont> getFont(Style style);
+
+    // Faces searched, in order, for the characters the face of a style does not have. Their glyphs are rasterized
+    // into the atlas of the style. Fallbacks should be added before creating labels, labels only pick them up
+    // when they change faces
+    void addFallback(std::shared_ptr<GLFont> font);
+    const std::vector<std::shared_ptr<GLFont>>& getFallbacks();
+    std::vector<FT_Face> getFallbackFaces();
+
+private:
+    std::shared_ptr<GLFont> _fonts[BoldItalic + 1]; // indexed by style, null for the styles the family lacks
+    std::vector<std::shared_ptr<GLFont>> _fallbacks;
+};
+
+#endif //GLFONT_FONTFAMILY_H
@@ -0,0 +1,75 @@
+#ifndef GLFONT_FONTREGISTRY_H
+#define GLFONT_FONTREGISTRY_H
+
+#include <GLFont/GLConfig.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+class MappedFile;
+
+// Process-wide registry of the open font faces. Each font file is memory mapped once and every face is opened
+// from the mapping with a single FreeType library, so opening the same font in many places costs no extra I/O
+// or memory. Faces are reference counted through the returned handles and closed with the last one.
+class FontRegistry {
+public:
+    // A face opened from a mapped font file
+    class Face {
+    public:
+        ~Face();
+
+        Face(const Face&) = delete;
+        Face& operator=(const Face&) = delete;
+
+        inline FT_Face getHandle() { return _face; }
+        inline const std::string& getFontFile() { return _fontFile; }
+        // Unique for the life of the process, unlike the address of the FT_Face which is reused once it is closed
+        inline uint64_t getId() { return _id; }
+        // Serializes FreeType calls on the face from several threads. FT_Face objects are not thread safe, and the
+        // pixel size selected on the face is shared by the atlases of every size
+        inline std::mutex& getMutex() { return _mutex; }
+
+        // The font file contents, valid as long as the face
+        const unsigned char* getData();
+        size_t getSize();
+
+    private:
+        friend class FontRegistry;
+
+        Face() {}
+
+        std::shared_ptr<FT_LibraryRec_> _library;
+        std::shared_ptr<MappedFile> _file;
+        FT_Face _face;
+        std::string _fontFile;
+        uint64_t _id;
+        std::mutex _mutex;
+    };
+
+    // Returns the face of the given file, opening it if needed. Throws std::runtime_error if the file cannot be
+    // read or is not a font FreeType supports
+    static std::shared_ptr<Face> open(const std::string& fontFile, long faceIndex = 0);
+    // Returns the open face whose handle is face, or null if the face was not opened by the registry
+    static std::shared_ptr<Face> find(FT_Face face);
+
+    // Number of faces currently open
+    static size_t size();
+
+private:
+    typedef std::pair<std::string, long> Key;
+
+    static std::map<Key, std::weak_ptr<Face>> _faces;
+    static std::map<FT_Face, std::weak_ptr<Face>> _handles; // the faces of _faces by handle, for find()
+    static std::map<std::string, std::weak_ptr<MappedFile>> _files;
+    static std::weak_ptr<FT_LibraryRec_> _library;
+    static uint64_t _nextId;
+
+    // Guards the maps, and the library: FreeType does not allow opening or closing faces of a library concurrently
+    static std::mutex _mutex;
+};
+
+#endif //GLFONT_FONTREGISTRY_H
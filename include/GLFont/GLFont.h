@@ -3,6 +3,8 @@
 
 #include <GLFont/GLConfig.h>
 #include <GLFont/FTLabel.h>
+#include <GLFont/FontRegistry.h>
+#include <memory>
 #include <string>
 
 class GLFont {
@@ -22,9 +24,7 @@ public:
 
 private:
     std::string _fontFile;
-    FT_Error _error;
-    FT_Library _ft;
-    FT_Face _face;
+    std::shared_ptr<FontRegistry::Face> _face; // copies of a GLFont share the face
 
 };
 
@@ -10,6 +10,9 @@ public:
     ~GLUtils();
 
     static void loadShader(const std::string &shaderSource, GLenum shaderType, GLuint &programId);
+
+    // Returns an opaque handle identifying the GL context current on the calling thread
+    static void* getCurrentContext();
 };
 #endif //GLFONT_GLUTILS_H
 
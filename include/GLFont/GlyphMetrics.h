@@ -0,0 +1,32 @@
+#ifndef GLFONT_GLYPHMETRICS_H
+#define GLFONT_GLYPHMETRICS_H
+
+#include <cstdint>
+
+class WordCache;
+
+// Metrics of a font at one pixel size, all that is needed to lay text out. Implemented by FontAtlas; TextLayout only
+// depends on this interface, so that it does not need GL and can be fed metrics from anywhere (e.g. in tests)
+class GlyphMetrics {
+public:
+    virtual ~GlyphMetrics() {}
+
+    // Index of the glyph for a codepoint, which may add the glyph to the font
+    virtual unsigned getGlyphIndex(uint32_t codepoint) = 0;
+    // Pen advance of a glyph, in pixels
+    virtual float getAdvanceX(unsigned index) = 0;
+    virtual float getAdvanceY(unsigned index) = 0;
+    // Whether the glyph has no pixels to draw (e.g. spaces)
+    virtual bool isBlank(unsigned index) = 0;
+    // Horizontal kerning, in pixels, to add to the advance of left when followed by right
+    virtual float getKerning(uint32_t left, uint32_t right) = 0;
+
+    virtual int getPixelSize() = 0;
+    // Distance between two baselines, in pixels
+    virtual int getLineHeight() = 0;
+
+    // Cache of the words laid out with these metrics, shared by their users. Null if words are not cached
+    virtual WordCache* getWordCache() { return nullptr; }
+};
+
+#endif //GLFONT_GLYPHMETRICS_H
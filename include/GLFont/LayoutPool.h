@@ -0,0 +1,53 @@
+#ifndef GLFONT_LAYOUTPOOL_H
+#define GLFONT_LAYOUTPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class FTLabel;
+
+// Brings many labels up to date at once, e.g. after a window resize. Line breaking, glyph positioning and quads are
+// computed by a pool of worker threads, then the vertices are uploaded in a single pass on the calling thread,
+// which must own the GL context. Glyphs missing from the atlases are added beforehand, on the calling thread too.
+// Labels that only lay out on the GL thread (FTConsole, FTFieldLabel) are updated there as usual
+class LayoutPool {
+public:
+    // Pool of the given number of threads, counting the calling thread. 0 uses one per core
+    explicit LayoutPool(unsigned threads = 0);
+    ~LayoutPool();
+
+    // Lay out the labels changed since their last update and upload their vertices, as render() would
+    void update(const std::vector<FTLabel*>& labels);
+
+    inline unsigned getThreadCount() { return static_cast<unsigned>(_threads.size()) + 1; }
+
+private:
+    std::vector<std::thread> _threads;
+
+    // Task being run, on indices 0 to _taskSize, by the workers and the calling thread
+    std::mutex _mutex;
+    std::condition_variable _wake; // a task was started, or the pool is stopping
+    std::condition_variable _done; // a worker finished its share of the task
+    std::function<void(size_t)> _task;
+    size_t _taskSize;
+    std::atomic<size_t> _nextIndex;
+    unsigned _generation; // number of the current task, so that workers run each task once
+    unsigned _busy; // workers still running the current task
+    bool _stop;
+
+    // Labels laid out by the workers, and the codepoints each has that are missing from its atlas
+    std::vector<FTLabel*> _parallel;
+    std::vector<std::vector<uint32_t>> _missing;
+
+    // Run task(i) for every i below count, spread over the pool, and return once all are done
+    void parallelFor(size_t count, const std::function<void(size_t)>& task);
+    void runTask();
+    void work();
+};
+
+#endif //GLFONT_LAYOUTPOOL_H
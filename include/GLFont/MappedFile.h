@@ -0,0 +1,30 @@
+#ifndef GLFONT_MAPPEDFILE_H
+#define GLFONT_MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file. The OS pages the contents in on first access
+class MappedFile {
+public:
+    // Throws std::runtime_error if the file cannot be opened or mapped
+    MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    inline const unsigned char* getData() const { return _data; }
+    inline size_t getSize() const { return _size; }
+
+private:
+    const unsigned char* _data;
+    size_t _size;
+
+#if defined(_WIN32)
+    void* _file;
+    void* _mapping;
+#endif
+};
+
+#endif //GLFONT_MAPPEDFILE_H
@@ -0,0 +1,39 @@
+#ifndef GLFONT_SHADERPROGRAM_H
+#define GLFONT_SHADERPROGRAM_H
+
+#include <GLFont/GLConfig.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+// Linked GLSL program with cached uniform locations.
+// Programs obtained through get() are compiled once per GL context and shared by every caller,
+// so per-object state such as colors and matrices must be set as uniforms before each draw.
+class ShaderProgram {
+public:
+    ShaderProgram(const char* vertexSource, const char* fragmentSource);
+    ~ShaderProgram();
+
+    inline GLuint getProgramId() { return _programId; }
+
+    // Returns the location of a uniform, querying GL only the first time
+    GLint getUniformLocation(const std::string& name);
+
+    // Returns the program registered under name for the current context, compiling it on first use.
+    // The program is deleted when the last holder releases it
+    static std::shared_ptr<ShaderProgram> get(const std::string& name, const char* vertexSource, const char* fragmentSource);
+
+private:
+    GLuint _programId;
+    std::map<std::string, GLint> _uniforms;
+
+    typedef std::pair<void*, std::string> Key; // (GL context, program name)
+
+    static std::map<Key, std::weak_ptr<ShaderProgram>> _programs;
+    static std::mutex _mutex;
+};
+
+#endif //GLFONT_SHADERPROGRAM_H
@@ -0,0 +1,49 @@
+#ifndef GLFONT_STATISTICS_H
+#define GLFONT_STATISTICS_H
+
+#include <atomic>
+#include <cstdint>
+
+// Counters of the work done by the labels and atlases of the process, queryable at any time from any thread.
+// Counting is a relaxed atomic add per layout, upload or draw (never per glyph), so they can stay on in production.
+// Labels also keep the counters of their own work, see FTLabel::getStatistics()
+class Statistics {
+public:
+    enum Counter {
+        Relayouts,             // texts laid out again; consoles count each line they lay out
+        Vertices,              // vertices generated, or glyph instances sent with instanced rendering
+        BytesUploaded,         // vertices and atlas data sent to GL
+        DrawCalls,
+        GpuNanoseconds,        // GPU time of the renders timed with FTLabel::setGpuTiming()
+        AtlasBuilds,           // atlases rasterized from a face
+        AtlasBuildNanoseconds, // time spent building them, summed over the threads building atlases
+        AtlasTextureBytes,     // GL memory currently held by atlas textures, which reset() leaves alone
+        CounterCount
+    };
+
+    // Values of every counter at one point in time
+    struct Counters {
+        int64_t values[CounterCount] = {};
+
+        inline int64_t operator[](Counter counter) const { return values[counter]; }
+        // Work done between two snapshots
+        Counters operator-(const Counters& other) const;
+    };
+
+    static inline void add(Counter counter, int64_t value = 1) {
+        _counters[counter].fetch_add(value, std::memory_order_relaxed);
+    }
+
+    static inline int64_t get(Counter counter) { return _counters[counter].load(std::memory_order_relaxed); }
+    static Counters snapshot();
+    // Set the cumulative counters back to 0
+    static void reset();
+
+    // Short name of the counter, e.g. "draw_calls", for logs and JSON output
+    static const char* getName(Counter counter);
+
+private:
+    static std::atomic<int64_t> _counters[CounterCount];
+};
+
+#endif //GLFONT_STATISTICS_H
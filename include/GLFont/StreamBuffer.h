@@ -0,0 +1,57 @@
+#ifndef GLFONT_STREAMBUFFER_H
+#define GLFONT_STREAMBUFFER_H
+
+#include <GLFont/GLConfig.h>
+
+#include <cstddef>
+
+// GL buffer for data that is rewritten frequently (e.g. vertices of labels whose text changes every frame).
+// Uploads never shrink the storage, so a buffer that has reached its working size stops reallocating.
+class StreamBuffer {
+public:
+    enum Mode {
+        // Orphan the storage and write it with glBufferSubData. Always available
+        Orphaning,
+        // Write into a persistently mapped ring buffer, guarded by fences (GL 4.4 or ARB_buffer_storage)
+        PersistentRing
+    };
+
+    StreamBuffer(GLenum target = GL_ARRAY_BUFFER, Mode mode = Orphaning);
+    ~StreamBuffer();
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    // Copy size bytes into the buffer and return the offset at which they were written, which is
+    // a multiple of alignment. In Orphaning mode the offset is always 0.
+    // Note: the buffer id may change when a ring buffer has to grow, so bind it after uploading
+    size_t upload(const void* data, size_t size, size_t alignment = 1);
+
+    inline GLuint getBufferId() { return _buffer; }
+    inline Mode getMode() { return _mode; }
+    inline size_t getCapacity() { return _capacity; }
+
+    // Whether the PersistentRing mode can be used with the current context
+    static bool isPersistentMappingSupported();
+
+private:
+    static const int NumSegments = 3; // ring segments, each guarded by its own fence
+
+    GLenum _target;
+    Mode _mode;
+    GLuint _buffer;
+    size_t _capacity; // bytes
+
+    // Ring buffer state
+    unsigned char* _mapped;
+    size_t _head; // next write position in bytes
+    int _segment; // segment containing _head
+    GLsync _fences[NumSegments];
+
+    void allocateRing(size_t capacity);
+    void releaseRing();
+    // Wait until the GPU is done reading a segment before overwriting it
+    void waitSegment(int segment);
+};
+
+#endif //GLFONT_STREAMBUFFER_H
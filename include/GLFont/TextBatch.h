@@ -0,0 +1,71 @@
+#ifndef GLFONT_TEXTBATCH_H
+#define GLFONT_TEXTBATCH_H
+
+#include <GLFont/GLConfig.h>
+#include <GLFont/FontAtlas.h>
+#include <GLFont/StreamBuffer.h>
+
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+class FTLabel;
+class ShaderProgram;
+
+// Collects the glyph quads of many labels and draws them with one draw call per font atlas.
+// Usage: call FTLabel::render(batch) for every label, then TextBatch::render() once per frame.
+class TextBatch {
+public:
+    TextBatch();
+    ~TextBatch();
+
+    // Queue the current glyph quads of a label. Nothing is drawn until render() is called
+    void add(FTLabel& label);
+
+    // Draw all queued labels, sorted by atlas, and empty the batch
+    void render();
+
+    // Drop all queued labels without drawing them
+    void clear();
+
+private:
+
+    struct Vertex {
+        GLfloat x{0.0}; // x in clip coordinates (label transform already applied)
+        GLfloat y{0.0}; // y in clip coordinates
+        GLfloat s{0.0}; // glyph x offset in texture coordinates
+        GLfloat t{0.0}; // glyph y offset in texture coordinates
+        GLfloat layer{0.0}; // atlas page holding the glyph
+        GLfloat r{0.0}; // text color
+        GLfloat g{0.0};
+        GLfloat b{0.0};
+        GLfloat a{0.0};
+
+        Vertex() {}
+
+        Vertex(float x, float y, float s, float t, float layer, const glm::vec4& color) :
+            x(x), y(y), s(s), t(t), layer(layer), r(color.x), g(color.y), b(color.z), a(color.w) {}
+    };
+
+    struct Range {
+        FontAtlas::RenderMode mode;
+        GLuint texture;
+        GLint first;
+        GLsizei count;
+    };
+
+    std::shared_ptr<ShaderProgram> _program;
+    std::shared_ptr<ShaderProgram> _distanceFieldProgram; // only loaded once a distance field label is drawn
+    GLuint _vao;
+    StreamBuffer _vertexBuffer;
+
+    // Queued vertices, keyed by render mode and atlas texture so that draws come out sorted by program and atlas
+    std::map<std::pair<FontAtlas::RenderMode, GLuint>, std::vector<Vertex>> _vertices;
+
+    // Scratch storage reused from frame to frame to avoid reallocations
+    std::vector<Vertex> _stream;
+    std::vector<Range> _ranges;
+};
+
+#endif //GLFONT_TEXTBATCH_H
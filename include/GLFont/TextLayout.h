@@ -0,0 +1,97 @@
+#ifndef GLFONT_TEXTLAYOUT_H
+#define GLFONT_TEXTLAYOUT_H
+
+#include <GLFont/GlyphMetrics.h>
+#include <GLFont/WordCache.h>
+
+#include <string_view>
+#include <vector>
+
+// Breaks text into lines and positions its glyphs, on the CPU only: the layout reads a GlyphMetrics and outputs
+// pixel positions, which a renderer turns into whatever it draws. It does not touch GL, so it can run on any thread
+// as long as its metrics are not used elsewhere at the same time.
+// Positions are in window pixels, y growing downwards. Horizontal positions are before the aspect ratio stretch,
+// which renderers apply when converting them, while widths include it
+class TextLayout {
+public:
+    enum Alignment {
+        Left,
+        Center,
+        Right
+    };
+
+    // Glyph with pixels to draw, at its pen position on the baseline
+    struct Glyph {
+        unsigned index; // glyph index in the metrics
+        float x;
+        float y;
+    };
+
+    // Line box: part of the text fitting the maximum width, and the run of its glyphs
+    struct Line {
+        std::string_view text;
+        size_t firstGlyph; // range of the glyphs of the line in getGlyphs()
+        size_t endGlyph;
+        float x; // left edge, after alignment and indentation
+        float y; // top edge
+        float baseline;
+        int width; // in pixels
+    };
+
+    TextLayout();
+
+    // The metrics are not owned, and must outlive the calls to layout()
+    void setMetrics(GlyphMetrics* metrics);
+    // Pixels of the text per pixel of the metrics, e.g. to draw an atlas at another size
+    void setScale(float scale);
+    void setAspectRatio(float x, float y);
+    // Width lines are wrapped at and height lines stop at, in pixels. 0 for no limit
+    void setMaxSize(int width, int height);
+    void setAlignment(Alignment alignment);
+    // Offset of the first line, in pixels
+    void setIndentation(int pixels);
+
+    // Lay the text out from (x, y), the top of the first line. Depending on the alignment, x is the left edge,
+    // the middle or the right edge of the lines. Previous results are replaced; the lines point into the text,
+    // which must outlive them
+    void layout(std::string_view text, float x = 0, float y = 0);
+
+    inline const std::vector<Glyph>& getGlyphs() { return _glyphs; }
+    inline const std::vector<Line>& getLines() { return _lines; }
+    // Extents of the lines laid out, in pixels
+    inline int getWidth() { return _width; }
+    inline float getHeight() { return _lines.size() * getLineHeight(); }
+    // Distance between two baselines, in pixels
+    float getLineHeight();
+
+private:
+    GlyphMetrics* _metrics;
+    float _scale;
+    float _arsx;
+    float _arsy;
+    int _maxWidth;
+    int _maxHeight;
+    Alignment _alignment;
+    int _indentation;
+
+    // Glyph of the text, measured once by breakLines(), with its advance in metrics pixels kerned with the next
+    // codepoint of the text
+    typedef WordCache::Glyph MeasuredGlyph;
+
+    // Results and scratch storage, kept between layouts so that they stop allocating
+    std::vector<MeasuredGlyph> _measured;
+    std::vector<Line> _lines; // ranges of _measured until the glyphs are placed
+    std::vector<Glyph> _glyphs;
+    int _width;
+
+    // Break text into lines of words fitting in the maximum width, measuring its glyphs. Words end after a space.
+    // Results go to _lines and _measured, in a single pass over the text
+    void breakLines(std::string_view text);
+    // Append the glyphs of a word to _measured, the last one not kerned, and return the width of the word in
+    // whole pixels. Words are taken from the word cache of the metrics if possible
+    int measureWord(std::string_view word);
+    // Position the measured glyphs of a line, starting at the pen position (x, y)
+    void placeLine(Line& line, float x, float y);
+};
+
+#endif //GLFONT_TEXTLAYOUT_H
@@ -0,0 +1,102 @@
+#ifndef GLFONT_TEXTMEASURE_H
+#define GLFONT_TEXTMEASURE_H
+
+#include <GLFont/GLConfig.h>
+#include <GLFont/FTLabel.h>
+#include <GLFont/TextLayout.h>
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class FontAtlas;
+class GLFont;
+
+// Measures text the way a label with the same settings lays it out, without a label or any GL call, e.g. to size
+// UI panels. Results are kept in a least recently used cache, so measuring the same strings every frame costs a
+// hash lookup each. Glyphs are taken from the atlases shared with the labels (through FontAtlasCache), which this
+// keeps alive, so measure on the thread drawing the labels
+class TextMeasure {
+public:
+    // Extents of a line, in pixels, relative to the origin of the text. x depends on the alignment
+    struct LineExtents {
+        size_t begin; // byte range of the line in the text
+        size_t length;
+        float x;
+        float y; // top
+        int width;
+    };
+
+    struct Result {
+        int width; // of the widest line
+        int height; // of all the lines. FTLabel::getCurrentLabelHeight() counts one line more
+        size_t lineCount;
+        std::vector<LineExtents> lines;
+    };
+
+    // Cache of at most capacity results
+    explicit TextMeasure(size_t capacity = 4096);
+
+    // Measure text drawn with the font at a pixel size, wrapped at maxWidth pixels if not 0. Of the FTLabel flags,
+    // the alignment and Indented apply. The result is valid until the next call
+    const Result& measure(std::string_view text, const std::shared_ptr<GLFont>& font, int pixelSize, int maxWidth = 0,
+                          int flags = FTLabel::FontFlags::LeftAligned);
+
+    void clear();
+    inline size_t size() { return _entries.size(); }
+    inline size_t getCapacity() { return _capacity; }
+
+    // Number of measurements served from the cache, and computed
+    inline size_t getHits() { return _hits; }
+    inline size_t getMisses() { return _misses; }
+
+private:
+    // Flags changing the layout, the others do not make a different entry
+    static const int LayoutFlags = FTLabel::FontFlags::LeftAligned | FTLabel::FontFlags::RightAligned |
+                                   FTLabel::FontFlags::CenterAligned | FTLabel::FontFlags::Indented;
+
+    // Key of an entry. The text points into the entry (or the caller's text, for lookups), so that looking up does
+    // not copy it
+    struct Key {
+        std::string_view text;
+        FT_Face face;
+        int pixelSize;
+        int maxWidth;
+        int flags;
+
+        bool operator==(const Key& other) const;
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    struct Entry {
+        std::string text; // owned copy of the text of the key
+        Key key;
+        Result result;
+    };
+
+    // Atlas of a face and pixel size, holding the font so that the face outlives the entries keyed on it
+    struct Font {
+        std::shared_ptr<GLFont> font;
+        std::shared_ptr<FontAtlas> atlas;
+    };
+
+    size_t _capacity;
+    std::list<Entry> _entries; // most recently used first
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> _index;
+    std::map<std::pair<FT_Face, int>, Font> _fonts;
+    TextLayout _layout;
+
+    size_t _hits;
+    size_t _misses;
+};
+
+#endif //GLFONT_TEXTMEASURE_H
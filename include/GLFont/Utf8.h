@@ -0,0 +1,77 @@
+#ifndef GLFONT_UTF8_H
+#define GLFONT_UTF8_H
+
+#include <cstdint>
+
+class Utf8 {
+public:
+    static const uint32_t ReplacementCharacter = 0xFFFD;
+
+    // Decode the codepoint starting at p and move p past it. Returns 0, without moving p, at the end of the string.
+    // Malformed sequences decode to U+FFFD and are skipped one byte at a time
+    static inline uint32_t next(const char*& p) {
+        const unsigned char* s = reinterpret_cast<const unsigned char*>(p);
+
+        if(s[0] < 0x80) {
+            if(s[0])
+                ++p;
+            return s[0];
+        }
+
+        int length;
+        uint32_t codepoint;
+        if((s[0] & 0xE0) == 0xC0) {
+            length = 2;
+            codepoint = s[0] & 0x1F;
+        }
+        else if((s[0] & 0xF0) == 0xE0) {
+            length = 3;
+            codepoint = s[0] & 0x0F;
+        }
+        else if((s[0] & 0xF8) == 0xF0) {
+            length = 4;
+            codepoint = s[0] & 0x07;
+        }
+        else {
+            ++p;
+            return ReplacementCharacter;
+        }
+
+        // Continuation bytes are 10xxxxxx, which also stops at the terminating null character
+        for(int i = 1; i < length; ++i) {
+            if((s[i] & 0xC0) != 0x80) {
+                ++p;
+                return ReplacementCharacter;
+            }
+            codepoint = (codepoint << 6) | (s[i] & 0x3F);
+        }
+
+        p += length;
+        return codepoint;
+    }
+
+    // Same as next(), for text that is not null terminated and ends at end
+    static inline uint32_t next(const char*& p, const char* end) {
+        if(p >= end)
+            return 0;
+
+        // Sequences cut by the end are malformed, decode them from a terminated copy
+        const unsigned char lead = static_cast<unsigned char>(*p);
+        int length = lead < 0x80 ? 1 : (lead & 0xE0) == 0xC0 ? 2 : (lead & 0xF0) == 0xE0 ? 3 : (lead & 0xF8) == 0xF0 ? 4 : 1;
+        if(end - p < length) {
+            char sequence[4] = {};
+            for(int i = 0; i < end - p; ++i)
+                sequence[i] = p[i];
+
+            const char* s = sequence;
+            uint32_t codepoint = next(s);
+            p += s - sequence;
+            return codepoint;
+        }
+
+        // Embedded null characters end the text, like with next()
+        return next(p);
+    }
+};
+
+#endif //GLFONT_UTF8_H
@@ -0,0 +1,49 @@
+#ifndef GLFONT_WORDCACHE_H
+#define GLFONT_WORDCACHE_H
+
+#include <cstddef>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Glyphs and width of the words laid out with a font, so that laying the same words out again (e.g. when labels are
+// wrapped again on resize) costs a lookup per word instead of decoding and measuring every character. Owned by the
+// font (see GlyphMetrics::getWordCache()) and shared by everything laying text out with it, from any thread
+class WordCache {
+public:
+    // Words cached at most, the cache starts over past this
+    static const size_t MaxWords = 16384;
+
+    // Glyph of a word, with its advance in pixels of the font, kerned with the next glyph of the word
+    struct Glyph {
+        unsigned index;
+        float advance;
+    };
+
+    // Append the glyphs of the word to glyphs and set its width, in whole pixels at the given scale. Returns false,
+    // leaving glyphs as they were, if the word is not cached
+    bool find(std::string_view word, float scale, std::vector<Glyph>& glyphs, int& width);
+    void insert(std::string_view word, float scale, int width, const Glyph* glyphs, size_t count);
+
+    void clear();
+    size_t size();
+
+private:
+    struct Word {
+        std::string text;
+        float scale;
+        int width;
+        std::vector<Glyph> glyphs;
+    };
+
+    // Words are indexed by hash, so that looking up does not copy the word. Words with the same hash as another
+    // word already cached are not cached
+    std::unordered_map<size_t, Word> _words;
+    std::shared_mutex _mutex; // lookups share the cache, inserts have it to themselves
+
+    static size_t hash(std::string_view word, float scale);
+};
+
+#endif //GLFONT_WORDCACHE_H
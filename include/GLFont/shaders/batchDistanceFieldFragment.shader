@@ -0,0 +1,17 @@
+R"(
+#version 330 core
+
+in vec2 texcoord;
+flat in float layer;
+in vec4 textColor;
+uniform sampler2DArray tex; // distance field, 0.5 on the outline and growing towards the inside
+out vec4 color;
+
+void main() {
+    float distance = texture(tex, vec3(texcoord, layer)).r;
+
+    // Antialias over about one screen pixel, whatever the size the glyph is drawn at
+    float smoothing = 0.5 * fwidth(distance);
+    color = vec4(textColor.rgb, smoothstep(0.5 - smoothing, 0.5 + smoothing, distance));
+}
+)"
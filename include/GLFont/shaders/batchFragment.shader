@@ -0,0 +1,13 @@
+R"(
+#version 330 core
+
+in vec2 texcoord;
+flat in float layer;
+in vec4 textColor;
+uniform sampler2DArray tex;
+out vec4 color;
+
+void main() {
+    color = vec4(textColor.rgb, texture(tex, vec3(texcoord, layer)).r);
+}
+)"
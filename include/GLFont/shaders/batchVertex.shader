@@ -0,0 +1,18 @@
+R"(
+#version 330 core
+
+layout(location = 0) in vec4 uv;
+layout(location = 1) in float page;
+layout(location = 2) in vec4 color;
+out vec2 texcoord;
+flat out float layer;
+out vec4 textColor;
+
+void main() {
+    // Positions are already transformed into clip space when the batch is built
+    gl_Position = vec4(uv.xy, 0, 1);
+    texcoord = uv.zw;
+    layer = page;
+    textColor = color;
+}
+)"
@@ -2,11 +2,12 @@ R"(
 #version 330 core
 
 in vec2 texcoord;
+flat in float layer;
 uniform vec4 textColor;
-uniform sampler2D tex;
+uniform sampler2DArray tex;
 out vec4 color;
 
 void main() {
-    color = vec4(textColor.rgb, texture(tex, texcoord).r);
+    color = vec4(textColor.rgb, texture(tex, vec3(texcoord, layer)).r);
 }
 )"
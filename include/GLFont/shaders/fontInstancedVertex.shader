@@ -0,0 +1,24 @@
+R"(
+#version 330 core
+
+layout(location = 0) in vec2 origin; // pen position of the glyph
+layout(location = 1) in uint glyph;  // index of the glyph in the atlas
+uniform mat4 mvp;
+uniform vec2 glyphScale;             // normalized units per glyph pixel
+uniform samplerBuffer glyphMetrics;  // three texels per glyph, see FontAtlas
+out vec2 texcoord;
+flat out float layer;
+
+void main() {
+    vec4 box = texelFetch(glyphMetrics, int(glyph) * 3);     // left, top, width, height (pixels)
+    vec4 uvs = texelFetch(glyphMetrics, int(glyph) * 3 + 1); // left, top, right, bottom (texture coordinates)
+
+    // Triangle strip corners: (0, 0) (1, 0) (0, 1) (1, 1), from the top left corner of the glyph
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+
+    vec2 pos = origin + vec2(box.x + corner.x * box.z, box.y - corner.y * box.w) * glyphScale;
+    gl_Position = mvp * vec4(pos, 0, 1);
+    texcoord = mix(uvs.xy, uvs.zw, corner);
+    layer = texelFetch(glyphMetrics, int(glyph) * 3 + 2).x;
+}
+)"
@@ -2,11 +2,14 @@ R"(
 #version 330 core
 
 layout(location = 0) in vec4 uv;
+layout(location = 1) in float page;
 uniform mat4 mvp;
 out vec2 texcoord;
+flat out float layer;
 
 void main() {
     gl_Position = mvp * vec4 (uv.xy, 0, 1);
     texcoord = uv.zw;
+    layer = page;
 }
 )"
@@ -0,0 +1,356 @@
+#include <GLFont/FTConsole.h>
+#include <GLFont/ShaderProgram.h>
+#include <GLFont/TextBatch.h>
+
+#include <algorithm>
+#include <cstddef>
+
+// GLM
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+FTConsole::FTConsole(std::shared_ptr<GLFont> ftFace, float x, float y, int width, int height, int windowWidth, int windowHeight) :
+  FTLabel(ftFace, windowWidth, windowHeight),
+  _maxLines(1000),
+  _firstRow(0),
+  _baseRow(0),
+  _scrollRow(0),
+  _followTail(true),
+  _ringBuffer(0),
+  _ringCapacity(0),
+  _ringHead(0)
+{
+    _x = x;
+    _y = y;
+    _maxWidth = width;
+    _maxHeight = height;
+
+    // The ring has its own buffer and vertex array, with the layout of the quads of FTLabel
+    glGenVertexArrays(1, &_ringVao);
+    glGenBuffers(1, &_ringBuffer);
+    allocateRing(MinRingVertices);
+
+    glBindVertexArray(_ringVao);
+    glBindBuffer(GL_ARRAY_BUFFER, _ringBuffer);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Point), 0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(Point), (const void*)(4 * sizeof(GLfloat)));
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+FTConsole::~FTConsole() {
+    glDeleteBuffers(1, &_ringBuffer);
+    glDeleteVertexArrays(1, &_ringVao);
+}
+
+void FTConsole::appendLine(const std::string& text) {
+    // Lines are laid out with the current settings, so bring the older ones up to date first
+    updateLayout();
+
+    size_t begin = 0;
+    while(true) {
+        size_t end = text.find('\n', begin);
+
+        Line line;
+        line.text = text.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+        writeLine(line);
+
+        if(end == std::string::npos)
+            break;
+        begin = end + 1;
+    }
+
+    if(_followTail)
+        _scrollRow = bottomRow();
+}
+
+void FTConsole::clear() {
+    _lines.clear();
+    _rows.clear();
+    _firstRow = 0;
+    _baseRow = 0;
+    _scrollRow = 0;
+    _followTail = true;
+    _ringHead = 0;
+}
+
+void FTConsole::setMaxLines(size_t lines) {
+    _maxLines = std::max<size_t>(lines, 1);
+
+    while(_lines.size() > _maxLines)
+        dropFirstLine();
+
+    if(_followTail)
+        _scrollRow = bottomRow();
+}
+
+size_t FTConsole::getMaxLines() {
+    return _maxLines;
+}
+
+size_t FTConsole::getLineCount() {
+    return _lines.size();
+}
+
+void FTConsole::scroll(int rows) {
+    size_t row = _scrollRow - _firstRow;
+    if(rows < 0)
+        scrollTo(row - std::min<size_t>(row, static_cast<size_t>(-rows)));
+    else
+        scrollTo(row + rows);
+}
+
+void FTConsole::scrollTo(size_t row) {
+    size_t bottom = bottomRow();
+    _scrollRow = std::min(_firstRow + row, bottom);
+    _followTail = _scrollRow == bottom;
+}
+
+void FTConsole::scrollToBottom() {
+    _scrollRow = bottomRow();
+    _followTail = true;
+}
+
+size_t FTConsole::getScrollRow() {
+    return _scrollRow - _firstRow;
+}
+
+size_t FTConsole::getRowCount() {
+    return _rows.size();
+}
+
+void FTConsole::update() {
+    updateLayout();
+}
+
+void FTConsole::render() {
+    updateLayout();
+
+    if(_rows.empty())
+        return;
+
+    size_t begin = _scrollRow - _firstRow;
+    size_t end = std::min(_rows.size(), begin + visibleRows());
+
+    glBindVertexArray(_ringVao);
+    glUseProgram(_program->getProgramId());
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    glUniform4fv(_uniformTextColorHandle, 1, glm::value_ptr(_textColor));
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, _fontAtlas->getTexId());
+    glUniform1i(_uniformTextureHandle, 0);
+
+    // Consecutive rows are contiguous in the ring unless it wrapped in between, and share their base row unless
+    // new lines started another one, so this is one to three draws
+    beginGpuTimer();
+    size_t i = begin;
+    while(i < end) {
+        GLint first = _rows[i].first;
+        GLsizei count = _rows[i].count;
+        size_t base = _rows[i].base;
+        for(++i; i < end && _rows[i].first == first + count && _rows[i].base == base; ++i)
+            count += _rows[i].count;
+
+        if(count) {
+            // Rows are laid out from their base row down, move them up so that the first visible row is at the top.
+            // The base of a visible row is close to it, so the difference is small, though maybe negative
+            float rows = static_cast<float>(static_cast<ptrdiff_t>(_scrollRow - base));
+            glm::mat4 mvp = _mvp * glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, rows * rowHeight() * _sy, 0.0f));
+            glUniformMatrix4fv(_uniformMVPHandle, 1, GL_FALSE, glm::value_ptr(mvp));
+
+            glDrawArrays(GL_TRIANGLES, first, count);
+            FTLabel::count(Statistics::DrawCalls);
+        }
+    }
+    endGpuTimer();
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    glDisable(GL_BLEND);
+    glUseProgram(0);
+    glBindVertexArray(0);
+}
+
+void FTConsole::render(TextBatch& batch) {
+    batch.render();
+    render();
+}
+
+void FTConsole::updateLayout() {
+    updateAtlas();
+
+    if(_dirty & LayoutDirty)
+        rebuild();
+}
+
+float FTConsole::rowHeight() {
+    return _fontAtlas->getLineHeight() * _glyphScale * _arsy;
+}
+
+size_t FTConsole::visibleRows() {
+    if(!_maxHeight)
+        return _rows.size();
+
+    return std::max<size_t>(static_cast<size_t>(_maxHeight / rowHeight()), 1);
+}
+
+size_t FTConsole::bottomRow() {
+    size_t visible = visibleRows();
+    return _firstRow + (_rows.size() > visible ? _rows.size() - visible : 0);
+}
+
+size_t FTConsole::layoutLine(const std::string& text, size_t row) {
+    // Row positions grow with every line: start from a new base row before they get too far for floats to place
+    // glyphs precisely. Rows keep the base they were laid out with, so no line has to be laid out again
+    if((row - _baseRow) * rowHeight() > MaxRowOffset)
+        _baseRow = row;
+
+    setupLayout(_maxWidth, 0);
+    _layout.layout(text, _x, _y + (row - _baseRow) * rowHeight());
+    count(Statistics::Relayouts);
+
+    size_t firstVertex = _coords.size();
+
+    // Rows start relative to the quads of the line, writeLine() moves them to the line position in the ring
+    for(const TextLayout::Line& line : _layout.getLines()) {
+        _glyphs.clear();
+        placeGlyphs(line.firstGlyph, line.endGlyph);
+
+        Row r;
+        r.first = static_cast<GLint>(_coords.size());
+        r.base = _baseRow;
+        for(const GlyphInstance& glyph : _glyphs)
+            appendQuad(glyph);
+        r.count = static_cast<GLsizei>(_coords.size() - r.first);
+        _rows.push_back(r);
+    }
+
+    count(Statistics::Vertices, _coords.size() - firstVertex);
+
+    // Empty lines still take a row
+    if(_layout.getLines().empty()) {
+        Row r = {static_cast<GLint>(_coords.size()), 0, _baseRow};
+        _rows.push_back(r);
+        return 1;
+    }
+
+    return _layout.getLines().size();
+}
+
+void FTConsole::writeLine(Line& line) {
+    _coords.clear();
+    line.rows = layoutLine(line.text, _firstRow + _rows.size());
+    line.vertexCount = _coords.size();
+
+    // Write after the last line, or from the start of the ring if the line does not fit before the end
+    size_t head = _ringHead;
+    size_t first = head + line.vertexCount > _ringCapacity ? 0 : head;
+    bool wrapped = first != head;
+
+    if(line.vertexCount > _ringCapacity) {
+        _lines.push_back(line);
+        rebuild(2 * line.vertexCount);
+        return;
+    }
+
+    // Drop the lines in the way, oldest first: those left at the end of the ring when wrapping, then those
+    // overlapping the new line
+    while(true) {
+        size_t i = 0;
+        while(i < _lines.size() && !_lines[i].vertexCount)
+            ++i;
+        if(i == _lines.size())
+            break;
+
+        const Line& oldest = _lines[i];
+        bool skipped = wrapped && oldest.firstVertex >= head;
+        bool overlaps = oldest.firstVertex < first + line.vertexCount && first < oldest.firstVertex + oldest.vertexCount;
+        if(!skipped && !overlaps)
+            break;
+
+        // The ring cannot hold the whole history yet, grow it instead
+        if(_lines.size() < _maxLines) {
+            _lines.push_back(line);
+            rebuild(2 * _ringCapacity);
+            return;
+        }
+
+        for(size_t dropped = 0; dropped <= i; ++dropped)
+            dropFirstLine();
+    }
+
+    for(size_t r = _rows.size() - line.rows; r < _rows.size(); ++r)
+        _rows[r].first += static_cast<GLint>(first);
+
+    if(line.vertexCount) {
+        glBindBuffer(GL_ARRAY_BUFFER, _ringBuffer);
+        glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(Point), line.vertexCount * sizeof(Point), _coords.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        count(Statistics::BytesUploaded, line.vertexCount * sizeof(Point));
+    }
+
+    line.firstVertex = first;
+    _ringHead = first + line.vertexCount;
+    _lines.push_back(line);
+
+    while(_lines.size() > _maxLines)
+        dropFirstLine();
+}
+
+void FTConsole::dropFirstLine() {
+    const Line& line = _lines.front();
+    for(size_t r = 0; r < line.rows; ++r)
+        _rows.pop_front();
+
+    _firstRow += line.rows;
+    _lines.pop_front();
+
+    _scrollRow = std::max(_scrollRow, _firstRow);
+}
+
+void FTConsole::rebuild(size_t capacity) {
+    while(_lines.size() > _maxLines)
+        dropFirstLine();
+
+    // Keep the view on the same row if the lines wrap the same way
+    size_t scrollRow = _scrollRow - _firstRow;
+
+    _rows.clear();
+    _coords.clear();
+    _baseRow = _firstRow;
+
+    // The lines are packed from the start of the ring, so quad positions are ring positions
+    for(Line& line : _lines) {
+        line.firstVertex = _coords.size();
+        line.rows = layoutLine(line.text, _firstRow + _rows.size());
+        line.vertexCount = _coords.size() - line.firstVertex;
+    }
+
+    // Reallocating also orphans the old contents, which may still be drawn from
+    allocateRing(std::max(std::max(capacity, _ringCapacity), 2 * _coords.size()));
+    if(!_coords.empty()) {
+        glBindBuffer(GL_ARRAY_BUFFER, _ringBuffer);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, _coords.size() * sizeof(Point), _coords.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        count(Statistics::BytesUploaded, _coords.size() * sizeof(Point));
+    }
+    _ringHead = _coords.size();
+
+    _scrollRow = _followTail ? bottomRow() : std::min(_firstRow + scrollRow, bottomRow());
+
+    _dirty &= ~(LayoutDirty | QuadsDirty | BufferDirty);
+}
+
+void FTConsole::allocateRing(size_t capacity) {
+    _ringCapacity = capacity;
+    _ringHead = 0;
+
+    glBindBuffer(GL_ARRAY_BUFFER, _ringBuffer);
+    glBufferData(GL_ARRAY_BUFFER, _ringCapacity * sizeof(Point), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
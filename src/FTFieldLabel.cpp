@@ -0,0 +1,192 @@
+#include <GLFont/FTFieldLabel.h>
+#include <GLFont/ShaderProgram.h>
+#include <GLFont/TextBatch.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+// GLM
+#include <glm/gtc/type_ptr.hpp>
+
+FTFieldLabel::FTFieldLabel(std::shared_ptr<GLFont> ftFace, float x, float y, int slots, int windowWidth, int windowHeight) :
+  FTLabel(ftFace, windowWidth, windowHeight),
+  _slotCount(std::min(std::max(slots, 1), static_cast<int>(MaxSlots))),
+  _slotWidth(0),
+  _originX(0)
+{
+    _x = x;
+    _y = y;
+
+    // Everything an update touches is allocated here
+    _slots.assign(_slotCount, ' ');
+    _uploaded.assign(_slotCount, 0);
+    _coords.reserve(MaxSlots * 6);
+
+    glGenVertexArrays(1, &_fieldVao);
+    glGenBuffers(1, &_fieldBuffer);
+
+    glBindVertexArray(_fieldVao);
+    glBindBuffer(GL_ARRAY_BUFFER, _fieldBuffer);
+    glBufferData(GL_ARRAY_BUFFER, _slotCount * 6 * sizeof(Point), NULL, GL_DYNAMIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Point), 0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(Point), (const void*)(4 * sizeof(GLfloat)));
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+FTFieldLabel::~FTFieldLabel() {
+    glDeleteBuffers(1, &_fieldBuffer);
+    glDeleteVertexArrays(1, &_fieldVao);
+}
+
+void FTFieldLabel::setNumber(double value, int precision) {
+    char text[MaxSlots + 1];
+    int length = snprintf(text, sizeof(text), "%.*f", std::min(std::max(precision, 0), 17), value);
+
+    // snprintf returns the untruncated length, longer values show as overflowing
+    if(length < 0 || length > _slotCount) {
+        std::fill(_slots.begin(), _slots.end(), '#');
+        return;
+    }
+
+    setField(text);
+}
+
+void FTFieldLabel::setNumber(long value) {
+    char text[MaxSlots + 1];
+    int length = snprintf(text, sizeof(text), "%ld", value);
+
+    if(length < 0 || length > _slotCount) {
+        std::fill(_slots.begin(), _slots.end(), '#');
+        return;
+    }
+
+    setField(text);
+}
+
+void FTFieldLabel::setField(const char* text) {
+    int length = static_cast<int>(std::strlen(text));
+
+    if(length > _slotCount) {
+        std::fill(_slots.begin(), _slots.end(), '#');
+        return;
+    }
+
+    // Right-aligned, so that the digits of numbers stay in place
+    int padding = _slotCount - length;
+    std::fill(_slots.begin(), _slots.begin() + padding, ' ');
+    for(int i = 0; i < length; ++i) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        _slots[padding + i] = c >= 32 && c < 128 ? static_cast<char>(c) : '?';
+    }
+}
+
+void FTFieldLabel::update() {
+    updateLayout();
+    uploadSlots();
+}
+
+void FTFieldLabel::render() {
+    update();
+
+    glBindVertexArray(_fieldVao);
+    glUseProgram(_program->getProgramId());
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    glUniform4fv(_uniformTextColorHandle, 1, glm::value_ptr(_textColor));
+    glUniformMatrix4fv(_uniformMVPHandle, 1, GL_FALSE, glm::value_ptr(_mvp));
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, _fontAtlas->getTexId());
+    glUniform1i(_uniformTextureHandle, 0);
+
+    beginGpuTimer();
+    glDrawArrays(GL_TRIANGLES, 0, _slotCount * 6);
+    endGpuTimer();
+    count(Statistics::DrawCalls);
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    glDisable(GL_BLEND);
+    glUseProgram(0);
+    glBindVertexArray(0);
+}
+
+void FTFieldLabel::render(TextBatch& batch) {
+    batch.render();
+    render();
+}
+
+void FTFieldLabel::updateLayout() {
+    updateAtlas();
+
+    if(!(_dirty & LayoutDirty))
+        return;
+
+    // Slots are as wide as the widest digit, rounded to whole pixels like the line breaker does
+    float advance = 0;
+    for(char c = '0'; c <= '9'; ++c)
+        advance = std::max(advance, _fontAtlas->getCharacter(_fontAtlas->getGlyphIndex(c)).advanceX);
+    _slotWidth = std::ceil(advance * _glyphScale);
+
+    float width = _slotWidth * _slotCount;
+    _originX = _x;
+    if(_alignment == FontFlags::CenterAligned)
+        _originX -= width / 2;
+    else if(_alignment == FontFlags::RightAligned)
+        _originX -= width;
+
+    _actualWidth = static_cast<int>(std::ceil(width * _arsx));
+    _actualHeight = static_cast<int>(std::ceil(_fontAtlas->getLineHeight() * _glyphScale * _arsy));
+
+    count(Statistics::Relayouts);
+
+    // Every quad has moved
+    std::fill(_uploaded.begin(), _uploaded.end(), 0);
+
+    _dirty &= ~LayoutDirty;
+}
+
+void FTFieldLabel::uploadSlots() {
+    int first = 0;
+    while(first < _slotCount && _slots[first] == _uploaded[first])
+        ++first;
+    if(first == _slotCount)
+        return;
+
+    int last = _slotCount - 1;
+    while(_slots[last] == _uploaded[last])
+        --last;
+
+    // Same baseline as FTLabel::recalculateVertices(), in normalized coordinates
+    float baseline = 1 - (_y + _fontAtlas->getLineHeight() * _glyphScale * _arsy) * _sy;
+
+    // Slots in between that did not change are rewritten too, so that a single upload covers them all
+    _coords.clear();
+    for(int i = first; i <= last; ++i) {
+        unsigned index = _fontAtlas->getGlyphIndex(static_cast<uint32_t>(_slots[i]));
+        const FontAtlas::Character& c = _fontAtlas->getCharacter(index);
+
+        size_t end = _coords.size() + 6;
+        if(c.bitmapWidth && c.bitmapHeight) {
+            // Center narrower glyphs (e.g. '.' or '-') in their slot
+            float x = _originX + i * _slotWidth + (_slotWidth - c.advanceX * _glyphScale) / 2;
+            appendQuad(GlyphInstance(-1 + x * _sx * _arsx, baseline, index));
+        }
+        _coords.resize(end); // degenerate quad for empty slots
+
+        _uploaded[i] = _slots[i];
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, _fieldBuffer);
+    glBufferSubData(GL_ARRAY_BUFFER, first * 6 * sizeof(Point), _coords.size() * sizeof(Point), _coords.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    count(Statistics::Vertices, _coords.size());
+    count(Statistics::BytesUploaded, _coords.size() * sizeof(Point));
+}
@@ -1,9 +1,15 @@
 #include <GLFont/FTLabel.h>
 #include <GLFont/GLUtils.h>
 #include <GLFont/FontAtlas.h>
+#include <GLFont/FontAtlasCache.h>
+#include <GLFont/FontFamily.h>
 #include <GLFont/GLFont.h>
+#include <GLFont/ShaderProgram.h>
+#include <GLFont/Utf8.h>
+#include <GLFont/TextBatch.h>
 
 #include <stdio.h>
+#include <chrono>
 #include <vector>
 #include <fstream>
 #include <sstream>
@@ -23,6 +29,7 @@
 
 FTLabel::FTLabel(std::shared_ptr<GLFont> ftFace, int windowWidth, int windowHeight) :
   _isInitialized(false),
+  _face(nullptr),
   _text(""),
   _alignment(FontFlags::LeftAligned),
   _textColor(0, 0, 0, 1),
@@ -35,9 +42,24 @@ FTLabel::FTLabel(std::shared_ptr<GLFont> ftFace, int windowWidth, int windowHeig
   _actualHeight(0),
   _actualWidth(0),
   _arsx(1.0),
-  _arsy(1.0)
+  _arsy(1.0),
+  _numVertices(0),
+  _firstVertex(0),
+  _vaoBuffer(0),
+  _vaoFirstInstance(0),
+  _instanced(false),
+  _renderMode(FontAtlas::Bitmap),
+  _glyphScale(1.0f),
+  _asyncAtlas(false),
+  _dirty(LayoutDirty),
+  _gpuTiming(false),
+  _timerQueries{},
+  _timerPending{},
+  _timerQuery(0),
+  _gpuTime(0)
 {
-    setFont(ftFace);
+    if(ftFace)
+        setFont(ftFace);
     setWindowSize(windowWidth, windowHeight);
 
     // Intially enabled flags
@@ -56,51 +78,15 @@ FTLabel::FTLabel(std::shared_ptr<GLFont> ftFace, int windowWidth, int windowHeig
 
     recalculateMVP();
 
-    // Load the shaders
-    _programId = glCreateProgram();
+    loadPrograms();
 
-    const std::string fontVertexSource =
-        #include <GLFont/shaders/fontVertex.shader>
-        ;
-
-    const std::string fontFragmentSource =
-        #include <GLFont/shaders/fontFragment.shader>
-        ;
-
-    GLUtils::loadShader(fontVertexSource, GL_VERTEX_SHADER, _programId);
-    GLUtils::loadShader(fontFragmentSource, GL_FRAGMENT_SHADER, _programId);
-
-    glUseProgram(_programId);
-
-    // Create and bind the vertex array object
+    // Create the vertex array object
     glGenVertexArrays(1, &_vao);
-    glBindVertexArray(_vao);
+    setupVertexArray();
 
     // Set default pixel size and create the texture
     setPixelSize(48); // default pixel size
 
-    // Get shader handles
-    _uniformTextureHandle = glGetUniformLocation(_programId, "tex");
-    _uniformTextColorHandle = glGetUniformLocation(_programId, "textColor");
-    _uniformMVPHandle = glGetUniformLocation(_programId, "mvp");
-
-    GLuint curTex = _fontAtlas[_pixelSize]->getTexId(); // get texture ID for this pixel size
-
-    glActiveTexture(GL_TEXTURE0 + curTex);
-    glBindTexture(GL_TEXTURE_2D, curTex);
-
-    // Set our uniforms
-    glUniform1i(_uniformTextureHandle, curTex);
-    glUniform4fv(_uniformTextColorHandle, 1, glm::value_ptr(_textColor));
-    glUniformMatrix4fv(_uniformMVPHandle, 1, GL_FALSE, glm::value_ptr(_mvp));
-
-    // Create the vertex buffer object
-    glGenBuffers(1, &_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, _vbo);
-    glBindVertexArray(0);
-
-    glUseProgram(0);
-
     _isInitialized = true;
 }
 
@@ -113,8 +99,6 @@ FTLabel::FTLabel(std::shared_ptr<GLFont> ftFace, const std::string& text, float
 {
     _maxWidth = maxWidth;
     _maxHeight = maxHeight;
-
-    recalculateVertices(text, x, y, maxWidth, maxHeight);
 }
 
 FTLabel::FTLabel(std::shared_ptr<GLFont> ftFace, const std::string &text, float x, float y, int windowWidth, int windowHeight) :
@@ -123,247 +107,429 @@ FTLabel(ftFace, windowWidth, windowHeight)
     _text = text;
     _x = x;
     _y = y;
+
+    _dirty |= LayoutDirty;
+}
+
+FTLabel::FTLabel(std::shared_ptr<FontAtlas> fontAtlas, int windowWidth, int windowHeight) :
+  FTLabel(std::shared_ptr<GLFont>(), windowWidth, windowHeight)
+{
+    setFontAtlas(fontAtlas);
+}
+
+FTLabel::FTLabel(std::shared_ptr<FontFamily> fontFamily, int windowWidth, int windowHeight) :
+  FTLabel(std::shared_ptr<GLFont>(), windowWidth, windowHeight)
+{
+    setFontFamily(fontFamily);
 }
 
 FTLabel::~FTLabel() {
-    glDeleteBuffers(1, &_vbo);
     glDeleteVertexArrays(1, &_vao);
-}
 
-void FTLabel::recalculateVertices(const std::string& text, float x, float y, int maxWidth, int maxHeight) {
+    if(_timerQueries[0])
+        glDeleteQueries(NumTimerQueries, _timerQueries);
+}
 
-    _coords.clear(); // case there are any existing coords
+void FTLabel::setupLayout(int maxWidth, int maxHeight) {
+    _layout.setMetrics(_fontAtlas.get());
+    _layout.setScale(_glyphScale);
+    _layout.setAspectRatio(_arsx, _arsy);
+    _layout.setMaxSize(maxWidth, maxHeight);
 
-    // Break the text into individual words
-    std::vector<std::string> words = splitText(_text);
+    if(_alignment == FontFlags::CenterAligned)
+        _layout.setAlignment(TextLayout::Center);
+    else if(_alignment == FontFlags::RightAligned)
+        _layout.setAlignment(TextLayout::Right);
+    else
+        _layout.setAlignment(TextLayout::Left);
 
-    std::vector<std::string> lines;
-    int widthRemaining = maxWidth;
-    int spaceWidth = calcWidth(" ");
-    int indent = (_flags & FontFlags::Indented) && _alignment != FontFlags::CenterAligned ? _pixelSize : 0;
+    _layout.setIndentation((_flags & FontFlags::Indented) && _alignment != FontFlags::CenterAligned ? _pixelSize : 0);
+}
 
-    // Create lines from our text, each containing the maximum amount of words we can fit within the given width
-    std::string curLine = "";
-    for(const std::string &word : words) {
-        int wordWidth = calcWidth(word.c_str());
+void FTLabel::recalculateVertices(std::string_view text, float x, float y, int maxWidth, int maxHeight) {
 
-        if(wordWidth - spaceWidth > widthRemaining && maxWidth /* make sure there is a width specified */) {
+    _glyphs.clear(); // case there are any existing glyphs
+    count(Statistics::Relayouts);
 
-            // If we have passed the given width, add this line to our collection and start a new line
-            lines.push_back(curLine);
-            widthRemaining = maxWidth - wordWidth;
-            curLine = "";
+    setupLayout(maxWidth, maxHeight);
+    _layout.layout(text, x, y);
+    placeGlyphs(0, _layout.getGlyphs().size());
 
-            // Start next line with current word
-            curLine.append(word.c_str());
-        }
-        else {
-            // Otherwise, add this word to the current line
-            curLine.append(word.c_str());
-            widthRemaining = widthRemaining - wordWidth;
-        }
-    }
+    // The height counts one more line than the text has
+    _actualWidth = _layout.getWidth();
+    _actualHeight = static_cast<int>(std::ceil(_layout.getHeight() + _layout.getLineHeight()));
+}
 
-    // Add the last line to lines
-    if(curLine != "")
-        lines.push_back(curLine);
-
-    // Print each line, increasing the y value as we go
-    float startY = y - (_face->size->metrics.height >> 6) * _arsy;
-    int lineWidth;
-    _actualWidth = 0;
-    for(const std::string &line : lines) {
-        // If we go past the specified height, stop drawing
-        if(y - startY > maxHeight && maxHeight)
-            break;
+void FTLabel::placeGlyphs(size_t firstGlyph, size_t endGlyph) {
+    const std::vector<TextLayout::Glyph>& glyphs = _layout.getGlyphs();
 
-        recalculateVertices(line.c_str(), x + indent, y);
-        y += (_face->size->metrics.height >> 6)  * _arsy;
-        indent = 0;
+    // Normalize window coordinates
+    for(size_t i = firstGlyph; i < endGlyph; ++i)
+        _glyphs.push_back(GlyphInstance(-1 + glyphs[i].x * _sx * _arsx, 1 - glyphs[i].y * _sy, glyphs[i].index));
+}
 
-        lineWidth = calcWidth(line.c_str());
-        if (lineWidth > _actualWidth)
-            _actualWidth = lineWidth;
-    }
+void FTLabel::recalculateQuads() {
+    _coords.clear();
+    _coords.reserve(_glyphs.size() * 6);
 
-    _actualHeight = static_cast<int>(std::ceil(y - startY));
+    for(const GlyphInstance& glyph : _glyphs)
+        appendQuad(glyph);
 
-    glBindVertexArray(_vao);
-    glUseProgram(_programId);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    count(Statistics::Vertices, _coords.size());
+}
 
-    GLuint curTex = _fontAtlas[_pixelSize]->getTexId();
-    glActiveTexture(GL_TEXTURE0 + curTex);
+void FTLabel::appendQuad(const GlyphInstance& glyph) {
+    const FontAtlas::Character& c = _fontAtlas->getCharacter(glyph.index);
 
-    glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+    float x2 = glyph.x + c.bitmapLeft * _glyphScale * _sx * _arsx; // scaled x coord
+    float y2 = glyph.y + c.bitmapTop * _glyphScale * _sy * _arsy;  // scaled y coord
+    float w = c.bitmapWidth * _glyphScale * _sx * _arsx;           // scaled width of character
+    float h = c.bitmapHeight * _glyphScale * _sy * _arsy;          // scaled height of character
 
-    glBindTexture(GL_TEXTURE_2D, curTex);
-    glUniform1i(_uniformTextureHandle, curTex);
+    float s0 = c.xOffset;              // texture atlas x offset
+    float t0 = c.yOffset;              // texture atlas y offset
+    float s1 = c.xOffset + c.uvWidth;
+    float t1 = c.yOffset + c.uvHeight;
+    float layer = c.page;              // texture atlas page
 
-    glEnableVertexAttribArray(0);
+    _coords.push_back(Point(x2, y2, s0, t0, layer));
+    _coords.push_back(Point(x2 + w, y2, s1, t0, layer));
+    _coords.push_back(Point(x2, y2 - h, s0, t1, layer));
 
-    // Send the data to the gpu
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Point), 0);
-    glBufferData(GL_ARRAY_BUFFER, _coords.size() * sizeof(Point), _coords.data(), GL_DYNAMIC_DRAW);
-    glDrawArrays(GL_TRIANGLES, 0, _coords.size());
-    _numVertices = _coords.size();
+    _coords.push_back(Point(x2 + w, y2, s1, t0, layer));
+    _coords.push_back(Point(x2, y2 - h, s0, t1, layer));
+    _coords.push_back(Point(x2 + w, y2 - h, s1, t1, layer));
+}
 
-    glDisableVertexAttribArray(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+void FTLabel::updateAtlas() {
+    if(!_pendingAtlas.valid() || _pendingAtlas.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        return;
 
-    glDisable(GL_BLEND);
-    glUseProgram(0);
-    glBindVertexArray(0);
+    // Keep the stand-in if the build failed
+    std::shared_ptr<FontAtlas> atlas = _pendingAtlas.get();
+    _pendingAtlas = std::shared_future<std::shared_ptr<FontAtlas>>();
+    if(!atlas)
+        return;
 
+    _fontAtlas = atlas;
+    _glyphScale = static_cast<float>(_pixelSize) / _fontAtlas->getPixelSize();
+    _dirty |= LayoutDirty;
 }
 
-void FTLabel::recalculateVertices(const char* text, float x, float y) {
+void FTLabel::updateLayout() {
+    updateAtlas();
 
-    // Coordinates passed in should specify where to start drawing from the top left of the text,
-    // but FreeType starts drawing from the bottom-right, therefore move down one line
-    y += (_face->size->metrics.height >> 6) * _arsy;
+    if(!(_dirty & LayoutDirty))
+        return;
 
-    // Calculate alignment (if applicable)
-    int textWidth = calcWidth(text);
-    if(_alignment == FontFlags::CenterAligned)
-        x -= textWidth / 2.0;
-    else if(_alignment == FontFlags::RightAligned)
-        x -= textWidth;
+    recalculateVertices(_text, _x, _y, _maxWidth, _maxHeight);
 
-    // Normalize window coordinates
-    x = -1 + x * _sx * _arsx;
-    y = 1 - y * _sy;
+    _dirty &= ~LayoutDirty;
+    _dirty |= QuadsDirty | BufferDirty;
+}
 
+void FTLabel::updateQuads() {
+    updateLayout();
 
-    int atlasWidth = _fontAtlas[_pixelSize]->getAtlasWidth();
-    int atlasHeight = _fontAtlas[_pixelSize]->getAtlasHeight();
+    if(!(_dirty & QuadsDirty))
+        return;
 
-    FontAtlas::Character* chars = _fontAtlas[_pixelSize]->getCharInfo();
+    recalculateQuads();
 
-    for(const char *p = text; *p; ++p) {
-        float x2 = x + chars[*p].bitmapLeft * _sx * _arsx; // scaled x coord
-        float y2 = -y - chars[*p].bitmapTop * _sy * _arsy; // scaled y coord
-        float w = chars[*p].bitmapWidth * _sx * _arsx;     // scaled width of character
-        float h = chars[*p].bitmapHeight * _sy * _arsy;    // scaled height of character
+    _dirty &= ~QuadsDirty;
+}
 
-        // Calculate kerning value
-        FT_Vector kerning;
-        FT_Get_Kerning(_face,              // font face handle
-                       *p,                 // left glyph
-                       *(p + 1),           // right glyph
-                       FT_KERNING_DEFAULT, // kerning mode
-                       &kerning);          // variable to store kerning value
+void FTLabel::updateGeometry() {
+    if(_dirty & LayoutDirty) {
+        recalculateVertices(_text, _x, _y, _maxWidth, _maxHeight);
 
-        // Advance cursor to start of next character
-        x += (chars[*p].advanceX + (kerning.x >> 6)) * _sx * _arsx;
-        y += chars[*p].advanceY * _sy * _arsy;
+        _dirty &= ~LayoutDirty;
+        _dirty |= QuadsDirty | BufferDirty;
+    }
 
-        // Skip glyphs with no pixels (e.g. spaces)
-        if(!w || !h)
-            continue;
+    if(!_instanced && (_dirty & QuadsDirty)) {
+        recalculateQuads();
+        _dirty &= ~QuadsDirty;
+    }
+}
 
-        _coords.push_back(Point(x2,                // window x
-                                -y2,               // window y
-                                chars[*p].xOffset, // texture atlas x offset
-                                0));               // texture atlas y offset
-
-        _coords.push_back(Point(x2 + w,
-                                -y2,
-                                chars[*p].xOffset + chars[*p].bitmapWidth / atlasWidth,
-                                0));
-
-        _coords.push_back(Point(x2,
-                                -y2 - h,
-                                chars[*p].xOffset,
-                                chars[*p].bitmapHeight / atlasHeight));
-
-        _coords.push_back(Point(x2 + w,
-                                -y2,
-                                chars[*p].xOffset + chars[*p].bitmapWidth / atlasWidth,
-                                0));
-
-        _coords.push_back(Point(x2,
-                                -y2 - h,
-                                chars[*p].xOffset,
-                                chars[*p].bitmapHeight / atlasHeight));
-
-        _coords.push_back(Point(x2 + w,
-                                -y2 - h,
-                                chars[*p].xOffset + chars[*p].bitmapWidth / atlasWidth,
-                                chars[*p].bitmapHeight / atlasHeight));
+void FTLabel::updateBuffer() {
+    if(_instanced)
+        updateLayout();
+    else
+        updateQuads();
+
+    if(!(_dirty & BufferDirty))
+        return;
+
+    // Send the data to the gpu: one instance per glyph, or six vertices per glyph
+    if(_instanced) {
+        size_t offset = _vertexBuffer.upload(_glyphs.data(), _glyphs.size() * sizeof(GlyphInstance), sizeof(GlyphInstance));
+        _firstVertex = static_cast<GLint>(offset / sizeof(GlyphInstance));
+        _numVertices = _glyphs.size();
+        count(Statistics::Vertices, _glyphs.size());
+        count(Statistics::BytesUploaded, _glyphs.size() * sizeof(GlyphInstance));
+    }
+    else {
+        size_t offset = _vertexBuffer.upload(_coords.data(), _coords.size() * sizeof(Point), sizeof(Point));
+        _firstVertex = static_cast<GLint>(offset / sizeof(Point));
+        _numVertices = _coords.size();
+        count(Statistics::BytesUploaded, _coords.size() * sizeof(Point));
     }
 
+    // Only a ring buffer moves the data or reallocates, an orphaned buffer keeps its id and always starts at 0
+    if(_vertexBuffer.getBufferId() != _vaoBuffer || (_instanced && _firstVertex != _vaoFirstInstance))
+        setupVertexArray();
+
+    _dirty &= ~BufferDirty;
+}
+
+void FTLabel::update() {
+    updateBuffer();
 }
 
 void FTLabel::render() {
+    // Commit any pending changes made through the setters since the last frame
+    updateBuffer();
+
+    if(_instanced) {
+        renderInstanced();
+        return;
+    }
+
     glBindVertexArray(_vao);
-    glUseProgram(_programId);
+    glUseProgram(_program->getProgramId());
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    GLuint curTex = _fontAtlas[_pixelSize]->getTexId();
-    glActiveTexture(GL_TEXTURE0 + curTex);
+    // The program is shared with other labels, so our uniforms have to be set before every draw
+    glUniform4fv(_uniformTextColorHandle, 1, glm::value_ptr(_textColor));
+    glUniformMatrix4fv(_uniformMVPHandle, 1, GL_FALSE, glm::value_ptr(_mvp));
 
-    glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+    GLuint curTex = _fontAtlas->getTexId();
+    glActiveTexture(GL_TEXTURE0 + curTex);
 
-    glBindTexture(GL_TEXTURE_2D, curTex);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, curTex);
     glUniform1i(_uniformTextureHandle, curTex);
 
-    glEnableVertexAttribArray(0);
+    beginGpuTimer();
+    glDrawArrays(GL_TRIANGLES, _firstVertex, _numVertices);
+    endGpuTimer();
+    count(Statistics::DrawCalls);
 
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Point), 0);
-    glDrawArrays(GL_TRIANGLES, 0, _numVertices);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
 
-    glDisableVertexAttribArray(0);
+    glDisable(GL_BLEND);
+    glUseProgram(0);
+    glBindVertexArray(0);
+}
 
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+void FTLabel::renderInstanced() {
+    glBindVertexArray(_vao);
+    glUseProgram(_instancedProgram->getProgramId());
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    glUniform4fv(_instancedProgram->getUniformLocation("textColor"), 1, glm::value_ptr(_textColor));
+    glUniformMatrix4fv(_instancedProgram->getUniformLocation("mvp"), 1, GL_FALSE, glm::value_ptr(_mvp));
+    glUniform2f(_instancedProgram->getUniformLocation("glyphScale"), _glyphScale * _sx * _arsx, _glyphScale * _sy * _arsy);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, _fontAtlas->getTexId());
+    glUniform1i(_instancedProgram->getUniformLocation("tex"), 0);
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_BUFFER, _fontAtlas->getGlyphMetricsTexId());
+    glUniform1i(_instancedProgram->getUniformLocation("glyphMetrics"), 1);
+
+    // Each instance is a glyph, whose quad is expanded by the vertex shader from the atlas metrics.
+    // The instances start at _firstVertex, where setupVertexArray() pointed the per-glyph attributes
+    beginGpuTimer();
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, _numVertices);
+    endGpuTimer();
+    count(Statistics::DrawCalls);
+
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
 
     glDisable(GL_BLEND);
     glUseProgram(0);
     glBindVertexArray(0);
 }
 
-std::vector<std::string> FTLabel::splitText(const std::string& text) {
-    std::vector<std::string> words;
-    size_t startPos = 0; // start position of current word
-    size_t endPos = text.find(' '); // end position of current word
+void FTLabel::beginGpuTimer() {
+    if(!_gpuTiming)
+        return;
+
+    // Collect the results that came back, oldest first. Queries complete in order, so the others are not ready either
+    for(int i = 0; i < NumTimerQueries; ++i) {
+        int query = (_timerQuery + i) % NumTimerQueries;
+        if(!_timerPending[query])
+            continue;
+
+        GLint available = 0;
+        glGetQueryObjectiv(_timerQueries[query], GL_QUERY_RESULT_AVAILABLE, &available);
+        if(!available)
+            break;
 
-    if(endPos == -1) {
-        // There is only one word, so return early
-        words.push_back(text);
-        return words;
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(_timerQueries[query], GL_QUERY_RESULT, &elapsed);
+        _timerPending[query] = false;
+
+        _gpuTime = elapsed / 1e6;
+        count(Statistics::GpuNanoseconds, static_cast<int64_t>(elapsed));
     }
 
-    // Find each word in the text (delimited by spaces) and add it to our std::vector of words
-    while(endPos != std::string::npos) {
-        words.push_back(text.substr(startPos, endPos  - startPos + 1));
-        startPos = endPos + 1;
-        endPos = text.find(' ', startPos);
+    // A query still pending here is reissued, and its result lost
+    glBeginQuery(GL_TIME_ELAPSED, _timerQueries[_timerQuery]);
+}
+
+void FTLabel::endGpuTimer() {
+    if(!_gpuTiming)
+        return;
+
+    glEndQuery(GL_TIME_ELAPSED);
+    _timerPending[_timerQuery] = true;
+    _timerQuery = (_timerQuery + 1) % NumTimerQueries;
+}
+
+void FTLabel::setupVertexArray() {
+    // Labels stream into an orphaned buffer whose id never changes, so the vertex layout only has to be
+    // recorded again when switching between per-vertex and per-glyph data, or when a ring buffer moves the data
+    _vaoBuffer = _vertexBuffer.getBufferId();
+
+    glBindVertexArray(_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, _vaoBuffer);
+
+    if(_instanced) {
+        _vaoFirstInstance = _firstVertex;
+        size_t base = _vaoFirstInstance * sizeof(GlyphInstance);
+
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(GlyphInstance), (const void*)base);
+        glVertexAttribDivisor(0, 1);
+        glEnableVertexAttribArray(1);
+        glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, sizeof(GlyphInstance), (const void*)(base + 2 * sizeof(GLfloat)));
+        glVertexAttribDivisor(1, 1);
+    }
+    else {
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Point), 0);
+        glVertexAttribDivisor(0, 0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(Point), (const void*)(4 * sizeof(GLfloat)));
+        glVertexAttribDivisor(1, 0);
     }
 
-    // Add last word
-    words.push_back(text.substr(startPos, std::min(endPos, text.size()) - startPos + 1));
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void FTLabel::setInstancedRendering(bool enabled) {
+    if(enabled == _instanced)
+        return;
+
+    _instanced = enabled;
+
+    loadPrograms();
+    setupVertexArray();
+    _dirty |= BufferDirty;
+}
+
+bool FTLabel::getInstancedRendering() {
+    return _instanced;
+}
+
+void FTLabel::setRenderMode(FontAtlas::RenderMode mode) {
+    if(mode == _renderMode || !_face)
+        return;
+
+    _renderMode = mode;
+
+    loadPrograms();
+    setPixelSize(_pixelSize);
+}
+
+FontAtlas::RenderMode FTLabel::getRenderMode() {
+    return _renderMode;
+}
+
+void FTLabel::setAsyncAtlasBuilding(bool enabled) {
+    _asyncAtlas = enabled;
+}
+
+bool FTLabel::getAsyncAtlasBuilding() {
+    return _asyncAtlas;
+}
 
-    return words;
+const Statistics::Counters& FTLabel::getStatistics() {
+    return _statistics;
 }
 
-int FTLabel::calcWidth(const char* text) {
-    int width = 0;
-    FontAtlas::Character* chars = _fontAtlas[_pixelSize]->getCharInfo();
-    for(const char* p = text; *p; ++p) {
-        width += static_cast<int>(std::ceil(chars[*p].advanceX));
+void FTLabel::resetStatistics() {
+    _statistics = Statistics::Counters();
+}
+
+void FTLabel::setGpuTiming(bool enabled) {
+    if(enabled && !_timerQueries[0])
+        glGenQueries(NumTimerQueries, _timerQueries);
+
+    _gpuTiming = enabled;
+}
+
+bool FTLabel::getGpuTiming() {
+    return _gpuTiming;
+}
+
+double FTLabel::getGpuTime() {
+    return _gpuTime;
+}
+
+void FTLabel::loadPrograms() {
+    // The programs are shared by all labels. They are compiled and linked by the first label of a context only
+    static const char* fontVertexSource =
+        #include <GLFont/shaders/fontVertex.shader>
+        ;
+
+    static const char* instancedVertexSource =
+        #include <GLFont/shaders/fontInstancedVertex.shader>
+        ;
+
+    static const char* fontFragmentSource =
+        #include <GLFont/shaders/fontFragment.shader>
+        ;
+
+    static const char* distanceFieldFragmentSource =
+        #include <GLFont/shaders/fontDistanceFieldFragment.shader>
+        ;
+
+    if(_renderMode == FontAtlas::DistanceField) {
+        _program = ShaderProgram::get("fontDistanceField", fontVertexSource, distanceFieldFragmentSource);
+        if(_instanced)
+            _instancedProgram = ShaderProgram::get("fontInstancedDistanceField", instancedVertexSource, distanceFieldFragmentSource);
+    }
+    else {
+        _program = ShaderProgram::get("font", fontVertexSource, fontFragmentSource);
+        if(_instanced)
+            _instancedProgram = ShaderProgram::get("fontInstanced", instancedVertexSource, fontFragmentSource);
     }
 
-    return width  * _arsx;
+    // Get shader handles (cached by the program, so this does not query GL again)
+    _uniformTextureHandle = _program->getUniformLocation("tex");
+    _uniformTextColorHandle = _program->getUniformLocation("textColor");
+    _uniformMVPHandle = _program->getUniformLocation("mvp");
+}
+
+void FTLabel::render(TextBatch& batch) {
+    // The batch reads the CPU side vertices, so there is no need to upload them to our own buffer
+    updateQuads();
+    batch.add(*this);
 }
 
 void FTLabel::setText(const std::string& text) {
     _text = text;
-
-    recalculateVertices(_text, _x, _y, _maxWidth, _maxHeight);
+    _dirty |= LayoutDirty;
 }
 
 std::string FTLabel::getText() {
@@ -373,10 +539,7 @@ std::string FTLabel::getText() {
 void FTLabel::setPosition(float x, float y) {
     _x = x;
     _y = y;
-
-    if(_text != "") {
-        recalculateVertices(_text, _x, _y, _maxWidth, _maxHeight);
-    }
+    _dirty |= LayoutDirty;
 }
 
 float FTLabel::getX() {
@@ -390,10 +553,7 @@ float FTLabel::getY() {
 void FTLabel::setMaxSize(int width, int height) {
     _maxWidth = width;
     _maxHeight = height;
-
-    if(_text != "") {
-        recalculateVertices(_text, _x, _y, width, height);
-    }
+    _dirty |= LayoutDirty;
 }
 
 int FTLabel::getWidth() {
@@ -406,6 +566,10 @@ int FTLabel::getHeight() {
 
 void FTLabel::setFontFlags(int flags) {
     _flags = flags;
+    _dirty |= LayoutDirty;
+
+    if(_fontFamily)
+        updateFamilyFont();
 }
 
 void FTLabel::setFontAspectRatio(float aspectRatio)
@@ -421,13 +585,15 @@ void FTLabel::setFontAspectRatio(float aspectRatio)
         _arsy = 1.0 / aspectRatio;
     }
 
-    if(_text != "") {
-        recalculateVertices(_text, _x, _y, _maxWidth, _maxHeight);
-    }
+    _dirty |= LayoutDirty;
 }
 
 void FTLabel::appendFontFlags(int flags) {
     _flags |= flags;
+    _dirty |= LayoutDirty;
+
+    if(_fontFamily)
+        updateFamilyFont();
 }
 
 int FTLabel::getFontFlags() {
@@ -436,18 +602,15 @@ int FTLabel::getFontFlags() {
 
 int FTLabel::getCurrentLabelHeight()
 {
-    if(_text != "") {
-        recalculateVertices(_text, _x, _y, _maxWidth, _maxHeight);
-    }
+    // Measuring only needs the layout, the vertices are uploaded at render time
+    updateLayout();
 
     return _actualHeight;
 }
 
 int FTLabel::getCurrentLabelWidth()
 {
-    if(_text != "") {
-        recalculateVertices(_text, _x, _y, _maxWidth, _maxHeight);
-    }
+    updateLayout();
 
     return _actualWidth;
 }
@@ -462,13 +625,6 @@ int FTLabel::getIndentation() {
 
 void FTLabel::setColor(float r, float b, float g, float a) {
     _textColor = glm::vec4(r, b, g, a);
-
-    // Update the textColor uniform
-    if(_programId != -1) {
-        glUseProgram(_programId);
-        glUniform4fv(_uniformTextColorHandle, 1, glm::value_ptr(_textColor));
-        glUseProgram(0);
-    }
 }
 
 glm::vec4 FTLabel::getColor() {
@@ -476,20 +632,71 @@ glm::vec4 FTLabel::getColor() {
 }
 
 void FTLabel::setFont(std::shared_ptr<GLFont> ftFace) {
+    _fontFamily.reset();
+    _fallbackFaces.clear();
+
     _ftFace = ftFace;
     _face = _ftFace->getFaceHandle(); // shortcut
+
+    // The atlas belongs to the previous face
+    if(_isInitialized)
+        setPixelSize(_pixelSize);
+}
+
+void FTLabel::setFontAtlas(std::shared_ptr<FontAtlas> fontAtlas) {
+    // The label only draws from this atlas from now on
+    _ftFace.reset();
+    _face = nullptr;
+    _fontFamily.reset();
+    _fallbackFaces.clear();
+
+    _fontAtlas = fontAtlas;
+    _renderMode = _fontAtlas->getRenderMode();
+    _pixelSize = _fontAtlas->getPixelSize();
+    _glyphScale = 1.0f;
+
+    loadPrograms();
+    _dirty |= LayoutDirty;
 }
 
 char* FTLabel::getFont() {
     return _font;
 }
 
+void FTLabel::setFontFamily(std::shared_ptr<FontFamily> fontFamily) {
+    _fontFamily = fontFamily;
+    _ftFace.reset(); // make sure the face and the atlas are picked again
+    _fallbackFaces = _fontFamily->getFallbackFaces();
+
+    updateFamilyFont();
+}
+
+std::shared_ptr<FontFamily> FTLabel::getFontFamily() {
+    return _fontFamily;
+}
+
+void FTLabel::updateFamilyFont() {
+    int style = FontFamily::Regular;
+    if(_flags & FontFlags::Bold)
+        style |= FontFamily::Bold;
+    if(_flags & FontFlags::Italic)
+        style |= FontFamily::Italic;
+
+    std::shared_ptr<GLFont> font = _fontFamily->getFont(static_cast<FontFamily::Style>(style));
+    if(font == _ftFace)
+        return;
+
+    _ftFace = font;
+    _face = _ftFace->getFaceHandle();
+
+    // Every style has its own atlases
+    if(_isInitialized)
+        setPixelSize(_pixelSize);
+}
+
 void FTLabel::setAlignment(FTLabel::FontFlags alignment) {
     _alignment = alignment;
-
-    if(_isInitialized) {
-        recalculateVertices(_text, _x, _y, _maxWidth, _maxHeight);
-    }
+    _dirty |= LayoutDirty;
 }
 
 FTLabel::FontFlags FTLabel::getAlignment() {
@@ -499,13 +706,39 @@ FTLabel::FontFlags FTLabel::getAlignment() {
 void FTLabel::setPixelSize(int size) {
     _pixelSize = size;
 
-    // Create texture atlas for characters of this pixel size if there isn't already one
-    if(!_fontAtlas[_pixelSize])
-        _fontAtlas[_pixelSize] = std::shared_ptr<FontAtlas>(new FontAtlas(_face, _pixelSize));
+    // Fixed atlases have a single size, scaled to the size of the label
+    if(!_face) {
+        if(_fontAtlas)
+            _glyphScale = static_cast<float>(_pixelSize) / _fontAtlas->getPixelSize();
 
-    if(_isInitialized) {
-        recalculateVertices(_text, _x, _y, _maxWidth, _maxHeight);
+        _dirty |= LayoutDirty;
+        return;
+    }
+
+    // Reuse the texture atlas of any other label with the same face and pixel size, or create it.
+    // Distance field atlases have a single size, scaled to the size of the label
+    int atlasSize = _renderMode == FontAtlas::DistanceField ? FontAtlas::DistanceFieldSize : _pixelSize;
+    _pendingAtlas = std::shared_future<std::shared_ptr<FontAtlas>>();
+
+    if(_asyncAtlas) {
+        std::shared_future<std::shared_ptr<FontAtlas>> atlas = FontAtlasCache::getAsync(_face, atlasSize, _renderMode, _fallbackFaces);
+        std::shared_ptr<FontAtlas> nearest = FontAtlasCache::getNearest(_face, atlasSize, _renderMode, _fallbackFaces);
+
+        // Draw with the closest size until the atlas is ready, unless there is nothing to draw with
+        if(atlas.wait_for(std::chrono::seconds(0)) != std::future_status::ready && nearest) {
+            _fontAtlas = nearest;
+            _pendingAtlas = atlas;
+        }
+        else {
+            _fontAtlas = atlas.get();
+        }
     }
+
+    if(!_asyncAtlas || !_fontAtlas)
+        _fontAtlas = FontAtlasCache::get(_face, atlasSize, _renderMode, _fallbackFaces);
+
+    _glyphScale = static_cast<float>(_pixelSize) / _fontAtlas->getPixelSize();
+    _dirty |= LayoutDirty;
 }
 
 void FTLabel::setWindowSize(int width, int height) {
@@ -516,9 +749,7 @@ void FTLabel::setWindowSize(int width, int height) {
     _sx = 2.0 / _windowWidth;
     _sy = 2.0 / _windowHeight;
 
-    if(_isInitialized) {
-        recalculateVertices(_text, _x, _y, _maxWidth, _maxHeight);
-    }
+    _dirty |= LayoutDirty;
 }
 
 void FTLabel::rotate(float degrees, float x, float y, float z) {
@@ -534,10 +765,4 @@ void FTLabel::scale(float x, float y, float z) {
 
 void FTLabel::recalculateMVP() {
     _mvp = _projection * _view * _model;
-
-    if(_uniformMVPHandle != -1) {
-        glUseProgram(_programId);
-        glUniformMatrix4fv(_uniformMVPHandle, 1, GL_FALSE, glm::value_ptr(_mvp));
-        glUseProgram(0);
-    }
 }
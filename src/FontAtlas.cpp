@@ -1,76 +1,908 @@
 #include <GLFont/FontAtlas.h>
+#include <GLFont/MappedFile.h>
+#include <GLFont/Statistics.h>
 
 #include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 
-FontAtlas::FontAtlas(FT_Face face, int pixelSize) :
+namespace {
+
+// Layout of baked atlas files. All values are 32 bits, in the byte order of the machine that baked the file,
+// so a file baked on a machine of the other endianness fails the magic check
+const char BakedMagic[4] = {'G', 'L', 'F', 'A'};
+const uint32_t BakedVersion = 1;
+
+struct BakedHeader {
+    char magic[4];
+    uint32_t version;
+    int32_t pixelSize;
+    int32_t renderMode;
+    int32_t lineHeight;
+    int32_t pageSize;
+    uint32_t pageCount;
+    uint32_t glyphCount;     // followed by glyphCount BakedGlyph
+    uint32_t codepointCount; // then codepointCount BakedCodepoint, for the non-ASCII glyphs
+    uint32_t hasKerning;     // then the dense ASCII kerning table if not 0
+    uint32_t kerningCount;   // then kerningCount BakedKerning, for other pairs
+    uint32_t notdefIndex;    // the pages come last, at a 16 bytes aligned offset
+};
+
+struct BakedGlyph {
+    float advanceX, advanceY;
+    float bitmapWidth, bitmapHeight;
+    float bitmapLeft, bitmapTop;
+    float xOffset, yOffset;
+    float uvWidth, uvHeight;
+    int32_t page;
+};
+
+struct BakedCodepoint {
+    uint32_t codepoint;
+    uint32_t index;
+};
+
+struct BakedKerning {
+    uint32_t left;
+    uint32_t right;
+    float value;
+};
+
+const size_t BakedPageAlignment = 16;
+
+}
+
+FontAtlas::FontAtlas(FT_Face face, int pixelSize, RenderMode mode, const std::vector<FT_Face>& fallbacks) :
   _face(face),
-  _width(0),
-  _height(0)
+  _library(nullptr),
+  _fallbacks(fallbacks),
+  _tex(0),
+  _metricsBuffer(0),
+  _metricsTex(0),
+  _textureBytes(0),
+  _metricsBytes(0),
+  _notdefIndex(0),
+  _hasKerning(false),
+  _pageSize(MinPageSize),
+  _textureDirty(true),
+  _uploadPending(false),
+  _metricsDirty(true),
+  _pixelSize(pixelSize),
+  _renderMode(mode)
 {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // Keep the font data of registry faces alive as long as the atlas may rasterize glyphs
+    std::shared_ptr<FontRegistry::Face> source = FontRegistry::find(_face);
+    if(source)
+        _sources.push_back(source);
+    _faceMutex = source ? &source->getMutex() : nullptr;
+    for(FT_Face fallback : _fallbacks) {
+        source = FontRegistry::find(fallback);
+        if(source)
+            _sources.push_back(source);
+    }
+
+    std::unique_lock<std::mutex> faceLock = lockFace();
+
     _slot = _face->glyph;
-    FT_Set_Pixel_Sizes(_face,      // Font face handle
-                       0,          // Pixel width  (0 defaults to pixel height)
-                       pixelSize); // Pixel height (0 defaults to pixel width)
+    selectSize(_face);
+
+    // The face is shared by atlases of every size, so keep the metrics of this size around
+    _lineHeight = _face->size->metrics.height >> 6;
 
-    int rowWidth = 0;
-    int colHeight = 0;
+    // Pick a page size fitting the printable ASCII characters with some room left for on-demand glyphs,
+    // estimating the average glyph at 0.6em wide. More pages are added when needed.
+    // Distance fields extend past the outline by the spread of the SDF renderer on each side
+    int margin = Padding + (_renderMode == DistanceField ? 2 * DistanceFieldSpread : 0);
+    float glyphArea = (0.6f * _pixelSize + margin) * (_lineHeight + margin);
+    float area = 1.5f * (AsciiCount - FirstChar) * glyphArea;
+    while(_pageSize < MaxPageSize && static_cast<float>(_pageSize) * _pageSize < area)
+        _pageSize *= 2;
+    addPage();
 
-    // Main char set (32 - 128)
-    for(int i = 32; i < 128; ++i) {
-        if(FT_Load_Char(_face, i, FT_LOAD_RENDER)) {
+    _glyphs.resize(AsciiCount);
+
+    // Main char set (32 - 128), rendered in parallel then packed in order
+    std::vector<GlyphBitmap> glyphs(AsciiCount - FirstChar);
+    for(uint32_t i = FirstChar; i < AsciiCount; ++i) {
+        GlyphBitmap& glyph = glyphs[i - FirstChar];
+        glyph.glyphIndex = findGlyph(i, glyph.face);
+        if(glyph.face)
+            _fallbackCodepoints[i] = glyph.face;
+    }
+
+    renderGlyphs(glyphs);
+
+    for(uint32_t i = FirstChar; i < AsciiCount; ++i) {
+        const GlyphBitmap& glyph = glyphs[i - FirstChar];
+        if(!glyph.loaded || !storeGlyph(glyph, _glyphs[i])) {
             fprintf(stderr, "Loading character %c failed!\n", i);
             continue; // try next character
         }
+    }
+
+    buildKerningTable();
+
+    Statistics::add(Statistics::AtlasBuilds);
+    Statistics::add(Statistics::AtlasBuildNanoseconds,
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
 
-        _width += _slot->bitmap.width + 2; // add the width of this glyph to our texture width
-        // Note: We add 2 pixels of blank space between glyphs for padding - this helps reduce texture bleeding
-        //       that can occur with antialiasing
+FontAtlas::FontAtlas() :
+  _face(nullptr),
+  _slot(nullptr),
+  _library(nullptr),
+  _tex(0),
+  _metricsBuffer(0),
+  _metricsTex(0),
+  _textureBytes(0),
+  _metricsBytes(0),
+  _notdefIndex(0),
+  _hasKerning(false),
+  _pageSize(MinPageSize),
+  _textureDirty(true),
+  _uploadPending(false),
+  _metricsDirty(true),
+  _faceMutex(nullptr),
+  _pixelSize(0),
+  _renderMode(Bitmap),
+  _lineHeight(0)
+{}
 
-        _height = std::max(_height, (int)_slot->bitmap.rows);
+FontAtlas::~FontAtlas() {
+    // Atlases built for baking never touch GL
+    if(_tex) {
+        glDeleteTextures(1, &_metricsTex);
+        glDeleteBuffers(1, &_metricsBuffer);
+        glDeleteTextures(1, &_tex);
     }
+    Statistics::add(Statistics::AtlasTextureBytes, -(_textureBytes + _metricsBytes));
 
-    // Create texture
-    glGenTextures(1, &_tex);
-    glActiveTexture(GL_TEXTURE0 + _tex);
-    glBindTexture(GL_TEXTURE_2D, _tex);
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if(_library)
+        FT_Done_FreeType(_library); // also releases the face
+}
 
-    // Set texture parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+std::shared_ptr<FontAtlas> FontAtlas::build(std::shared_ptr<FontRegistry::Face> source, int pixelSize, RenderMode mode,
+                                            const std::vector<std::shared_ptr<FontRegistry::Face>>& fallbacks) {
+    FT_Library library;
+    if(FT_Init_FreeType(&library)) {
+        fprintf(stderr, "Failed to initialize FreeType for an atlas build\n");
+        return nullptr;
+    }
+
+    FT_Face face = openFace(library, source->getHandle());
+    if(!face) {
+        fprintf(stderr, "Failed to open the face for an atlas build\n");
+        FT_Done_FreeType(library);
+        return nullptr;
+    }
+
+    std::vector<FT_Face> fallbackFaces;
+    for(const std::shared_ptr<FontRegistry::Face>& fallback : fallbacks) {
+        fallbackFaces.push_back(openFace(library, fallback->getHandle()));
+        if(!fallbackFaces.back()) {
+            fprintf(stderr, "Failed to open a fallback face for an atlas build\n");
+            FT_Done_FreeType(library);
+            return nullptr;
+        }
+    }
+
+    // The atlas keeps the faces to rasterize glyphs on demand later on, and the faces whose data they read
+    std::shared_ptr<FontAtlas> atlas(new FontAtlas(face, pixelSize, mode, fallbackFaces));
+    atlas->_library = library;
+    atlas->_sources.push_back(source);
+    atlas->_sources.insert(atlas->_sources.end(), fallbacks.begin(), fallbacks.end());
+
+    return atlas;
+}
 
-    // Create an empty texture with the correct dimensions
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, _width, _height, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+void FontAtlas::save(const std::string& path) {
+    std::ofstream file(path, std::ios::binary);
+    if(!file)
+        throw std::runtime_error("Failed to open " + path + " for writing");
 
-    int texPos = 0; // texture offset
+    BakedHeader header;
+    std::memcpy(header.magic, BakedMagic, sizeof(BakedMagic));
+    header.version = BakedVersion;
+    header.pixelSize = _pixelSize;
+    header.renderMode = _renderMode;
+    header.lineHeight = _lineHeight;
+    header.pageSize = _pageSize;
+    header.pageCount = static_cast<uint32_t>(_pages.size());
+    header.glyphCount = static_cast<uint32_t>(_glyphs.size());
+    header.codepointCount = static_cast<uint32_t>(_glyphIndices.size());
+    header.hasKerning = _hasKerning;
+    header.kerningCount = static_cast<uint32_t>(std::count_if(_kerningCache.begin(), _kerningCache.end(),
+        [](const std::pair<const uint64_t, float>& entry) { return entry.second != 0; }));
+    header.notdefIndex = _notdefIndex;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
 
-    for(int i = 32; i < 128; ++i) {
-        if(FT_Load_Char(_face, i, FT_LOAD_RENDER))
+    for(const Character& c : _glyphs) {
+        BakedGlyph glyph = {c.advanceX, c.advanceY, c.bitmapWidth, c.bitmapHeight, c.bitmapLeft, c.bitmapTop,
+                            c.xOffset, c.yOffset, c.uvWidth, c.uvHeight, c.page};
+        file.write(reinterpret_cast<const char*>(&glyph), sizeof(glyph));
+    }
+
+    for(const auto& entry : _glyphIndices) {
+        BakedCodepoint codepoint = {entry.first, entry.second};
+        file.write(reinterpret_cast<const char*>(&codepoint), sizeof(codepoint));
+    }
+
+    if(_hasKerning)
+        file.write(reinterpret_cast<const char*>(_kerning.data()), _kerning.size() * sizeof(float));
+
+    // Pairs missing from the file have no kerning
+    for(const auto& entry : _kerningCache) {
+        if(entry.second == 0)
             continue;
 
+        BakedKerning kerning = {static_cast<uint32_t>(entry.first >> 32), static_cast<uint32_t>(entry.first), entry.second};
+        file.write(reinterpret_cast<const char*>(&kerning), sizeof(kerning));
+    }
+
+    // Align the pages, so that they can be uploaded straight from the mapped file
+    static const char zeros[BakedPageAlignment] = {};
+    size_t offset = static_cast<size_t>(file.tellp());
+    file.write(zeros, (BakedPageAlignment - offset % BakedPageAlignment) % BakedPageAlignment);
+
+    size_t pageBytes = static_cast<size_t>(_pageSize) * _pageSize;
+    for(const Page& page : _pages)
+        file.write(reinterpret_cast<const char*>(page.baked ? page.baked : page.pixels.data()), pageBytes);
+
+    if(!file)
+        throw std::runtime_error("Failed to write " + path);
+}
+
+std::shared_ptr<FontAtlas> FontAtlas::load(const std::string& path) {
+    std::shared_ptr<MappedFile> file(new MappedFile(path));
+    const unsigned char* data = file->getData();
+    size_t size = file->getSize();
+    size_t offset = 0;
+
+    // Returns the next count records of the file, checking that they are there
+    auto read = [&](size_t recordSize, size_t count) {
+        if(count > (size - offset) / recordSize)
+            throw std::runtime_error("Failed to load " + path + ": truncated atlas file");
+
+        const unsigned char* records = data + offset;
+        offset += recordSize * count;
+        return records;
+    };
+
+    BakedHeader header;
+    std::memcpy(&header, read(sizeof(header), 1), sizeof(header));
+
+    if(std::memcmp(header.magic, BakedMagic, sizeof(BakedMagic)))
+        throw std::runtime_error("Failed to load " + path + ": not an atlas file");
+    if(header.version != BakedVersion)
+        throw std::runtime_error("Failed to load " + path + ": unsupported atlas file version");
+    if(header.pixelSize <= 0 || header.lineHeight <= 0 ||
+       header.pageSize < MinPageSize || header.pageSize > MaxPageSize || header.pageCount < 1 ||
+       header.glyphCount < AsciiCount || header.notdefIndex >= header.glyphCount ||
+       (header.renderMode != Bitmap && header.renderMode != DistanceField))
+        throw std::runtime_error("Failed to load " + path + ": corrupted atlas file");
+
+    std::shared_ptr<FontAtlas> atlas(new FontAtlas());
+    atlas->_file = file;
+    atlas->_pixelSize = header.pixelSize;
+    atlas->_renderMode = static_cast<RenderMode>(header.renderMode);
+    atlas->_lineHeight = header.lineHeight;
+    atlas->_pageSize = header.pageSize;
+    atlas->_notdefIndex = header.notdefIndex;
+
+    const unsigned char* glyphs = read(sizeof(BakedGlyph), header.glyphCount);
+    atlas->_glyphs.resize(header.glyphCount);
+    for(uint32_t i = 0; i < header.glyphCount; ++i) {
+        BakedGlyph glyph;
+        std::memcpy(&glyph, glyphs + i * sizeof(BakedGlyph), sizeof(glyph));
+        if(glyph.page < 0 || glyph.page >= static_cast<int32_t>(header.pageCount))
+            throw std::runtime_error("Failed to load " + path + ": corrupted atlas file");
+
+        Character& c = atlas->_glyphs[i];
+        c.advanceX = glyph.advanceX;
+        c.advanceY = glyph.advanceY;
+        c.bitmapWidth = glyph.bitmapWidth;
+        c.bitmapHeight = glyph.bitmapHeight;
+        c.bitmapLeft = glyph.bitmapLeft;
+        c.bitmapTop = glyph.bitmapTop;
+        c.xOffset = glyph.xOffset;
+        c.yOffset = glyph.yOffset;
+        c.uvWidth = glyph.uvWidth;
+        c.uvHeight = glyph.uvHeight;
+        c.page = glyph.page;
+    }
+
+    const unsigned char* codepoints = read(sizeof(BakedCodepoint), header.codepointCount);
+    for(uint32_t i = 0; i < header.codepointCount; ++i) {
+        BakedCodepoint codepoint;
+        std::memcpy(&codepoint, codepoints + i * sizeof(BakedCodepoint), sizeof(codepoint));
+        if(codepoint.index >= header.glyphCount)
+            throw std::runtime_error("Failed to load " + path + ": corrupted atlas file");
+
+        atlas->_glyphIndices[codepoint.codepoint] = codepoint.index;
+    }
+
+    atlas->_hasKerning = header.hasKerning != 0;
+    if(atlas->_hasKerning) {
+        const size_t count = (AsciiCount - FirstChar) * (AsciiCount - FirstChar);
+        atlas->_kerning.resize(count);
+        std::memcpy(atlas->_kerning.data(), read(sizeof(float), count), count * sizeof(float));
+    }
+
+    const unsigned char* pairs = read(sizeof(BakedKerning), header.kerningCount);
+    for(uint32_t i = 0; i < header.kerningCount; ++i) {
+        BakedKerning kerning;
+        std::memcpy(&kerning, pairs + i * sizeof(BakedKerning), sizeof(kerning));
+        atlas->_kerningCache[(static_cast<uint64_t>(kerning.left) << 32) | kerning.right] = kerning.value;
+    }
+
+    // The pages are not copied, they are uploaded from the mapping when the texture is first needed
+    read(1, (BakedPageAlignment - offset % BakedPageAlignment) % BakedPageAlignment);
+    size_t pageBytes = static_cast<size_t>(header.pageSize) * header.pageSize;
+    const unsigned char* pages = read(pageBytes, header.pageCount);
+
+    atlas->_pages.resize(header.pageCount);
+    for(uint32_t i = 0; i < header.pageCount; ++i) {
+        Page& page = atlas->_pages[i];
+        page.baked = pages + i * pageBytes;
+        page.height = header.pageSize;
+        page.uploadBegin = 0;
+        page.uploadEnd = 0;
+    }
+
+    return atlas;
+}
+
+void FontAtlas::selectSize(FT_Face face) {
+    if(face->size->metrics.y_ppem != _pixelSize) {
+        FT_Set_Pixel_Sizes(face,        // Font face handle
+                           0,           // Pixel width  (0 defaults to pixel height)
+                           _pixelSize); // Pixel height (0 defaults to pixel width)
+    }
+}
+
+FT_UInt FontAtlas::findGlyph(uint32_t codepoint, int& face) {
+    face = 0;
+    FT_UInt glyphIndex = FT_Get_Char_Index(_face, codepoint);
+
+    for(size_t i = 0; !glyphIndex && i < _fallbacks.size(); ++i) {
+        glyphIndex = FT_Get_Char_Index(_fallbacks[i], codepoint);
+        if(glyphIndex)
+            face = static_cast<int>(i) + 1;
+    }
+
+    return glyphIndex;
+}
+
+unsigned FontAtlas::lookupGlyph(uint32_t codepoint) {
+    auto it = _glyphIndices.find(codepoint);
+    if(it != _glyphIndices.end())
+        return it->second;
+
+    // Loaded atlases have no face to rasterize new glyphs with
+    if(!_face) {
+        _glyphIndices[codepoint] = _notdefIndex;
+        return _notdefIndex;
+    }
+
+    Character c;
+    unsigned index = 0;
+    std::unique_lock<std::mutex> faceLock = lockFace();
+
+    int face;
+    FT_UInt glyphIndex = findGlyph(codepoint, face);
+    if(glyphIndex && rasterize(face, glyphIndex, c)) {
+        index = static_cast<unsigned>(_glyphs.size());
+        _glyphs.push_back(c);
+        if(face)
+            _fallbackCodepoints[codepoint] = face;
+    }
+    else {
+        if(glyphIndex)
+            fprintf(stderr, "Loading character U+%04X failed!\n", codepoint);
+
+        // Glyph 0 of every face is the .notdef glyph (usually an empty box)
+        if(!_notdefIndex && rasterize(0, 0, c)) {
+            _notdefIndex = static_cast<unsigned>(_glyphs.size());
+            _glyphs.push_back(c);
+        }
+        index = _notdefIndex;
+    }
+
+    _glyphIndices[codepoint] = index;
+    return index;
+}
+
+float FontAtlas::lookupKerning(uint32_t left, uint32_t right) {
+    uint64_t key = (static_cast<uint64_t>(left) << 32) | right;
+    std::lock_guard<std::mutex> lock(_kerningMutex);
+
+    auto it = _kerningCache.find(key);
+    if(it != _kerningCache.end())
+        return it->second;
+
+    if(!_face)
+        return 0;
+
+    // Kerning pairs only make sense within a face
+    float value = 0;
+    if(!_fallbackCodepoints.count(left) && !_fallbackCodepoints.count(right)) {
+        std::unique_lock<std::mutex> faceLock = lockFace();
+        selectSize(_face);
+        value = kerning(FT_Get_Char_Index(_face, left), FT_Get_Char_Index(_face, right));
+    }
+
+    _kerningCache[key] = value;
+    return value;
+}
+
+float FontAtlas::kerning(FT_UInt left, FT_UInt right) {
+    FT_Vector kerning;
+
+    // Distance fields are drawn at other sizes, where rounding to pixels of the atlas size would add up
+    if(_renderMode == DistanceField) {
+        if(FT_Get_Kerning(_face, left, right, FT_KERNING_UNFITTED, &kerning))
+            return 0;
+
+        return kerning.x / 64.0f;
+    }
+
+    if(FT_Get_Kerning(_face, left, right, FT_KERNING_DEFAULT, &kerning))
+        return 0;
+
+    return kerning.x >> 6;
+}
+
+bool FontAtlas::rasterize(int face, FT_UInt glyphIndex, Character& c) {
+    GlyphBitmap glyph;
+    glyph.glyphIndex = glyphIndex;
+    glyph.face = face;
+
+    selectSize(getFace(face));
+    return renderGlyph(getFace(face), _renderMode, glyph) && storeGlyph(glyph, c);
+}
+
+bool FontAtlas::renderGlyph(FT_Face face, RenderMode mode, GlyphBitmap& glyph) {
+    glyph.loaded = false;
+
+    if(mode == DistanceField) {
+#if FREETYPE_MAJOR > 2 || (FREETYPE_MAJOR == 2 && FREETYPE_MINOR >= 11)
+        // Hinting would snap the outline to the pixel grid of the atlas size, not of the size drawn at
+        if(FT_Load_Glyph(face, glyph.glyphIndex, FT_LOAD_NO_HINTING) || FT_Render_Glyph(face->glyph, FT_RENDER_MODE_SDF))
+            return false;
+#else
+        fprintf(stderr, "Distance field atlases need FreeType 2.11 or later\n");
+        return false;
+#endif
+    }
+    else if(FT_Load_Glyph(face, glyph.glyphIndex, FT_LOAD_RENDER)) {
+        return false;
+    }
+
+    FT_GlyphSlot slot = face->glyph;
+    const FT_Bitmap& bitmap = slot->bitmap;
+    Character& c = glyph.metrics;
+
+    // Store glyph info for this pixel size
+    if(mode == DistanceField) {
+        // Keep the fractional advances, which are scaled to the pixel size of the label
+        c.advanceX = slot->linearHoriAdvance / 65536.0f;
+        c.advanceY = slot->advance.y / 64.0f;
+    }
+    else {
+        c.advanceX = slot->advance.x >> 6;
+        c.advanceY = slot->advance.y >> 6;
+    }
+
+    c.bitmapWidth = bitmap.width;
+    c.bitmapHeight = bitmap.rows;
+
+    c.bitmapLeft = slot->bitmap_left;
+    c.bitmapTop = slot->bitmap_top;
+
+    // Keep a tightly packed copy of the bitmap, the slot is overwritten by the next glyph
+    glyph.pixels.resize(static_cast<size_t>(bitmap.width) * bitmap.rows);
+    for(unsigned row = 0; row < bitmap.rows; ++row)
+        std::memcpy(&glyph.pixels[row * bitmap.width], bitmap.buffer + row * bitmap.pitch, bitmap.width);
+
+    glyph.loaded = true;
+    return true;
+}
+
+bool FontAtlas::storeGlyph(const GlyphBitmap& glyph, Character& c) {
+    int width = static_cast<int>(glyph.metrics.bitmapWidth);
+    int height = static_cast<int>(glyph.metrics.bitmapHeight);
+
+    // Glyphs without pixels (e.g. spaces) only need their metrics
+    int page = 0, x = 0, y = 0;
+    if(width && height) {
+        if(!allocate(width, height, page, x, y)) {
+            fprintf(stderr, "Glyph %u does not fit in a %dx%d atlas page\n", glyph.glyphIndex, _pageSize, _pageSize);
+            return false;
+        }
+
         // Add this character glyph to our texture
-        glTexSubImage2D(GL_TEXTURE_2D, 0, texPos, 0, _slot->bitmap.width, _slot->bitmap.rows, GL_RED, GL_UNSIGNED_BYTE, _slot->bitmap.buffer);
+        Page& p = _pages[page];
+        for(int row = 0; row < height; ++row)
+            std::memcpy(&p.pixels[(y + row) * _pageSize + x], &glyph.pixels[row * width], width);
+
+        // Remember which rows have to be sent to the GPU
+        if(p.uploadEnd <= p.uploadBegin) {
+            p.uploadBegin = y;
+            p.uploadEnd = y + height;
+        }
+        else {
+            p.uploadBegin = std::min(p.uploadBegin, y);
+            p.uploadEnd = std::max(p.uploadEnd, y + height);
+        }
+        _uploadPending = true;
+    }
+
+    c = glyph.metrics;
+    c.xOffset = (float)x / (float)_pageSize;
+    c.yOffset = (float)y / (float)_pageSize;
+    c.uvWidth = c.bitmapWidth / _pageSize;
+    c.uvHeight = c.bitmapHeight / _pageSize;
+    c.page = page;
+
+    _metricsDirty = true;
 
-        // Store glyph info in our char array for this pixel size
-        _chars[i].advanceX = _slot->advance.x >> 6;
-        _chars[i].advanceY = _slot->advance.y >> 6;
+    return true;
+}
+
+void FontAtlas::renderGlyphs(std::vector<GlyphBitmap>& glyphs) {
+    // Starting a worker costs a FreeType library and face, so only spread big enough jobs
+    size_t workers = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u),
+                                      (glyphs.size() + GlyphsPerWorker - 1) / GlyphsPerWorker);
+
+    // This thread takes the first share with our own faces, the workers each open the faces again since FreeType
+    // faces cannot be used from several threads at once
+    size_t share = workers ? (glyphs.size() + workers - 1) / workers : glyphs.size();
+    std::vector<std::thread> threads;
+    for(size_t begin = share; begin < glyphs.size(); begin += share) {
+        size_t end = std::min(begin + share, glyphs.size());
+
+        threads.push_back(std::thread([this, &glyphs, begin, end]() {
+            FT_Library library;
+            if(FT_Init_FreeType(&library))
+                return;
+
+            // Fallback faces are only opened if the share has glyphs from them
+            std::vector<FT_Face> faces(_fallbacks.size() + 1, nullptr);
+            std::vector<bool> opened(faces.size(), false);
+            for(size_t i = begin; i < end; ++i) {
+                int face = glyphs[i].face;
+                if(!opened[face]) {
+                    opened[face] = true;
+                    faces[face] = openFace(library, getFace(face));
+                    if(faces[face] && FT_Set_Pixel_Sizes(faces[face], 0, _pixelSize))
+                        faces[face] = nullptr;
+                }
+
+                if(faces[face])
+                    renderGlyph(faces[face], _renderMode, glyphs[i]);
+            }
+
+            FT_Done_FreeType(library); // also releases the face
+        }));
+    }
 
-        _chars[i].bitmapWidth = _slot->bitmap.width;
-        _chars[i].bitmapHeight = _slot->bitmap.rows;
+    selectSize(_face);
+    for(FT_Face fallback : _fallbacks)
+        selectSize(fallback);
 
-        _chars[i].bitmapLeft = _slot->bitmap_left;
-        _chars[i].bitmapTop = _slot->bitmap_top;
+    for(size_t i = 0; i < std::min(share, glyphs.size()); ++i)
+        renderGlyph(getFace(glyphs[i].face), _renderMode, glyphs[i]);
 
-        _chars[i].xOffset = (float)texPos / (float)_width;
+    for(std::thread& thread : threads)
+        thread.join();
 
-        // Increase texture offset
-        texPos += _slot->bitmap.width + 2;
+    // Glyphs a worker could not render (e.g. it failed to open the face) are retried here
+    for(GlyphBitmap& glyph : glyphs) {
+        if(!glyph.loaded)
+            renderGlyph(getFace(glyph.face), _renderMode, glyph);
     }
 }
 
-FontAtlas::~FontAtlas() {
-    glDeleteTextures(1, &_tex);
+FT_Face FontAtlas::openFace(FT_Library library, FT_Face source) {
+    FT_Face face = nullptr;
+    FT_Stream stream = source->stream;
+
+    // Faces opened from memory, or from files FreeType mapped, share the font data. Others open the file again
+    if(stream->base) {
+        if(FT_New_Memory_Face(library, stream->base, static_cast<FT_Long>(stream->size), source->face_index, &face))
+            return nullptr;
+    }
+    else if(stream->pathname.pointer) {
+        if(FT_New_Face(library, static_cast<const char*>(stream->pathname.pointer), source->face_index, &face))
+            return nullptr;
+    }
+
+    return face;
+}
+
+void FontAtlas::preload(const std::vector<uint32_t>& codepoints) {
+    // Loaded atlases cannot add glyphs. Map the missing codepoints to .notdef here rather than on first use, which
+    // may happen on the threads of a LayoutPool
+    if(!_face) {
+        for(uint32_t codepoint : codepoints) {
+            if(codepoint >= AsciiCount)
+                _glyphIndices.emplace(codepoint, _notdefIndex);
+        }
+        return;
+    }
+
+    std::unique_lock<std::mutex> faceLock = lockFace();
+    std::vector<GlyphBitmap> glyphs;
+    std::vector<uint32_t> missing;
+    for(uint32_t codepoint : codepoints) {
+        if(codepoint < AsciiCount || _glyphIndices.count(codepoint))
+            continue;
+
+        int face;
+        FT_UInt glyphIndex = findGlyph(codepoint, face);
+        if(!glyphIndex) {
+            missing.push_back(codepoint);
+            continue;
+        }
+
+        // Mark the codepoint as handled, so that duplicates are only rasterized once
+        _glyphIndices[codepoint] = _notdefIndex;
+
+        GlyphBitmap glyph;
+        glyph.glyphIndex = glyphIndex;
+        glyph.face = face;
+        glyph.codepoint = codepoint;
+        glyphs.push_back(glyph);
+    }
+
+    renderGlyphs(glyphs);
+
+    for(const GlyphBitmap& glyph : glyphs) {
+        Character c;
+        if(glyph.loaded && storeGlyph(glyph, c)) {
+            _glyphIndices[glyph.codepoint] = static_cast<unsigned>(_glyphs.size());
+            _glyphs.push_back(c);
+            if(glyph.face)
+                _fallbackCodepoints[glyph.codepoint] = glyph.face;
+        }
+        else {
+            // Fall back to .notdef like lookupGlyph() does
+            _glyphIndices.erase(glyph.codepoint);
+            missing.push_back(glyph.codepoint);
+        }
+    }
+    // Atlases with private faces (e.g. built ones) have no face mutex, and so nothing to unlock
+    if(faceLock)
+        faceLock.unlock();
+
+    for(uint32_t codepoint : missing)
+        lookupGlyph(codepoint);
+}
+
+bool FontAtlas::allocate(int width, int height, int& page, int& x, int& y) {
+    int paddedWidth = width + Padding;
+    int paddedHeight = height + Padding;
+
+    if(paddedWidth > _pageSize || paddedHeight > _pageSize)
+        return false;
+
+    // Best fit: the shelf with room left wasting the least height
+    Shelf* best = nullptr;
+    int bestPage = 0;
+    for(size_t i = 0; i < _pages.size(); ++i) {
+        for(Shelf& shelf : _pages[i].shelves) {
+            if(shelf.height < paddedHeight || shelf.width + paddedWidth > _pageSize)
+                continue;
+
+            if(!best || shelf.height < best->height) {
+                best = &shelf;
+                bestPage = static_cast<int>(i);
+            }
+        }
+    }
+
+    // Open a new shelf rather than wasting more than half of an existing one
+    bool canOpenShelf = _pages.back().height + paddedHeight <= _pageSize;
+    if(best && (best->height - paddedHeight <= paddedHeight / 2 || !canOpenShelf)) {
+        page = bestPage;
+        x = best->width;
+        y = best->y;
+        best->width += paddedWidth;
+        return true;
+    }
+
+    if(!canOpenShelf)
+        addPage();
+
+    Page& p = _pages.back();
+    Shelf shelf;
+    shelf.y = p.height;
+    shelf.height = paddedHeight;
+    shelf.width = paddedWidth;
+    p.shelves.push_back(shelf);
+    p.height += paddedHeight;
+
+    page = static_cast<int>(_pages.size()) - 1;
+    x = 0;
+    y = shelf.y;
+    return true;
+}
+
+void FontAtlas::addPage() {
+    Page page;
+    page.baked = nullptr;
+    page.pixels.assign(static_cast<size_t>(_pageSize) * _pageSize, 0);
+    page.height = 0;
+    page.uploadBegin = 0;
+    page.uploadEnd = 0;
+    _pages.push_back(page);
+
+    // The texture array has to be reallocated with one more layer
+    _textureDirty = true;
+}
+
+GLuint FontAtlas::getTexId() {
+    if(_tex && !_textureDirty && !_uploadPending)
+        return _tex;
+
+    if(!_tex) {
+        // Create texture
+        glGenTextures(1, &_tex);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, _tex);
+
+        // Set texture parameters
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        _textureDirty = true;
+    }
+    else {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, _tex);
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    if(_textureDirty) {
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R8, _pageSize, _pageSize, static_cast<GLsizei>(_pages.size()), 0,
+                     GL_RED, GL_UNSIGNED_BYTE, NULL);
+
+        int64_t bytes = static_cast<int64_t>(_pageSize) * _pageSize * _pages.size();
+        Statistics::add(Statistics::AtlasTextureBytes, bytes - _textureBytes);
+        _textureBytes = bytes;
+
+        // Stage every page in a pixel buffer and send them all in a single transfer, which the driver can run
+        // asynchronously instead of copying each page from client memory in turn
+        if(uploadPages()) {
+            for(Page& p : _pages)
+                p.uploadBegin = p.uploadEnd = 0;
+
+            _textureDirty = false;
+            _uploadPending = false;
+        }
+    }
+
+    for(size_t i = 0; i < _pages.size() && (_textureDirty || _uploadPending); ++i) {
+        Page& p = _pages[i];
+
+        // Only send the rows holding glyphs added since the last upload, unless the whole texture was reallocated
+        int begin = _textureDirty ? 0 : p.uploadBegin;
+        int end = _textureDirty ? p.height : p.uploadEnd;
+        end = std::min(end, _pageSize);
+        if(end > begin) {
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, begin, static_cast<GLint>(i), _pageSize, end - begin, 1,
+                            GL_RED, GL_UNSIGNED_BYTE, (p.baked ? p.baked : p.pixels.data()) + static_cast<size_t>(begin) * _pageSize);
+            Statistics::add(Statistics::BytesUploaded, static_cast<int64_t>(end - begin) * _pageSize);
+        }
+
+        p.uploadBegin = p.uploadEnd = 0;
+    }
+
+    _textureDirty = false;
+    _uploadPending = false;
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    return _tex;
+}
+
+bool FontAtlas::uploadPages() {
+    size_t pageBytes = static_cast<size_t>(_pageSize) * _pageSize;
+    size_t size = pageBytes * _pages.size();
+
+    GLuint buffer;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+
+    bool uploaded = false;
+    unsigned char* staging = static_cast<unsigned char*>(
+        glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    if(staging) {
+        for(size_t i = 0; i < _pages.size(); ++i)
+            std::memcpy(staging + i * pageBytes, _pages[i].baked ? _pages[i].baked : _pages[i].pixels.data(), pageBytes);
+
+        // The mapping can be lost (e.g. on a display mode change), then the pages are sent from client memory
+        if(glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER)) {
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, _pageSize, _pageSize, static_cast<GLsizei>(_pages.size()),
+                            GL_RED, GL_UNSIGNED_BYTE, 0);
+            Statistics::add(Statistics::BytesUploaded, static_cast<int64_t>(size));
+            uploaded = true;
+        }
+    }
+
+    // Deleting the buffer right away is fine, GL keeps it alive until the transfer is done
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glDeleteBuffers(1, &buffer);
+
+    return uploaded;
+}
+
+GLuint FontAtlas::getGlyphMetricsTexId() {
+    if(_metricsTex && !_metricsDirty)
+        return _metricsTex;
+
+    std::vector<GLfloat> metrics(_glyphs.size() * 12, 0.0f);
+
+    for(size_t i = 0; i < _glyphs.size(); ++i) {
+        const Character& c = _glyphs[i];
+        GLfloat* m = &metrics[i * 12];
+        m[0] = c.bitmapLeft;
+        m[1] = c.bitmapTop;
+        m[2] = c.bitmapWidth;
+        m[3] = c.bitmapHeight;
+        m[4] = c.xOffset;
+        m[5] = c.yOffset;
+        m[6] = c.xOffset + c.uvWidth;
+        m[7] = c.yOffset + c.uvHeight;
+        m[8] = static_cast<GLfloat>(c.page);
+    }
+
+    if(!_metricsTex) {
+        glGenBuffers(1, &_metricsBuffer);
+        glGenTextures(1, &_metricsTex);
+    }
+
+    glBindBuffer(GL_TEXTURE_BUFFER, _metricsBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, metrics.size() * sizeof(GLfloat), metrics.data(), GL_STATIC_DRAW);
+
+    int64_t bytes = static_cast<int64_t>(metrics.size() * sizeof(GLfloat));
+    Statistics::add(Statistics::BytesUploaded, bytes);
+    Statistics::add(Statistics::AtlasTextureBytes, bytes - _metricsBytes);
+    _metricsBytes = bytes;
+
+    glBindTexture(GL_TEXTURE_BUFFER, _metricsTex);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, _metricsBuffer);
+
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    _metricsDirty = false;
+
+    return _metricsTex;
+}
+
+void FontAtlas::buildKerningTable() {
+    _hasKerning = FT_HAS_KERNING(_face);
+    if(!_hasKerning)
+        return;
+
+    const int count = AsciiCount - FirstChar;
+
+    FT_UInt glyphIndices[count];
+    for(int i = 0; i < count; ++i)
+        glyphIndices[i] = FT_Get_Char_Index(_face, FirstChar + i);
+
+    // Note: the face still has our pixel size selected, so FreeType returns scaled and rounded values
+    _kerning.assign(count * count, 0.0f);
+    for(int left = 0; left < count; ++left) {
+        for(int right = 0; right < count; ++right)
+            _kerning[left * count + right] = kerning(glyphIndices[left], glyphIndices[right]);
+    }
 }
@@ -0,0 +1,191 @@
+#include <GLFont/FontAtlasCache.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+std::map<FontAtlasCache::Key, std::weak_ptr<FontAtlas>> FontAtlasCache::_atlases;
+std::map<FontAtlasCache::Key, FontAtlasCache::Future> FontAtlasCache::_pending;
+std::list<FontAtlasCache::Build> FontAtlasCache::_builds;
+std::mutex FontAtlasCache::_mutex;
+
+namespace {
+
+// Joins the builds at exit. Created with the first build, so it is destroyed before the statics of the cache,
+// the registry and the statistics, which were all initialized before
+struct ShutdownAtExit {
+    ~ShutdownAtExit() { FontAtlasCache::shutdown(); }
+};
+
+}
+
+std::shared_ptr<FontAtlas> FontAtlasCache::get(FT_Face face, int pixelSize, FontAtlas::RenderMode mode,
+                                               const std::vector<FT_Face>& fallbacks) {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    std::vector<std::shared_ptr<FontRegistry::Face>> sources;
+    Key key = makeKey(face, pixelSize, mode, fallbacks, sources);
+    std::shared_ptr<FontAtlas> atlas = _atlases[key].lock();
+    if(atlas)
+        return atlas;
+
+    // Wait for the atlas if it is already being built, rather than building it twice
+    auto pending = _pending.find(key);
+    if(pending != _pending.end()) {
+        atlas = pending->second.get();
+        _pending.erase(pending);
+        if(atlas) {
+            _atlases[key] = atlas;
+            return atlas;
+        }
+    }
+
+    // Drop entries whose atlases have already been released
+    for(auto it = _atlases.begin(); it != _atlases.end();) {
+        if(it->second.expired() && it->first != key)
+            it = _atlases.erase(it);
+        else
+            ++it;
+    }
+
+    atlas = std::shared_ptr<FontAtlas>(new FontAtlas(face, pixelSize, mode, fallbacks));
+    _atlases[key] = atlas;
+
+    return atlas;
+}
+
+std::shared_future<std::shared_ptr<FontAtlas>> FontAtlasCache::getAsync(FT_Face face, int pixelSize, FontAtlas::RenderMode mode,
+                                                                        const std::vector<FT_Face>& fallbacks) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    collect();
+
+    std::vector<std::shared_ptr<FontRegistry::Face>> sources;
+    Key key = makeKey(face, pixelSize, mode, fallbacks, sources);
+    auto pending = _pending.find(key);
+    if(pending != _pending.end())
+        return pending->second;
+
+    std::shared_ptr<std::promise<std::shared_ptr<FontAtlas>>> promise(new std::promise<std::shared_ptr<FontAtlas>>());
+    Future future = promise->get_future().share();
+
+    std::shared_ptr<FontAtlas> atlas = _atlases[key].lock();
+    if(atlas) {
+        promise->set_value(atlas);
+        return future;
+    }
+
+    // The build holds the faces, so faces the registry does not know could be closed before it is done
+    if(std::find(sources.begin(), sources.end(), nullptr) != sources.end()) {
+        atlas = std::shared_ptr<FontAtlas>(new FontAtlas(face, pixelSize, mode, fallbacks));
+        _atlases[key] = atlas;
+        promise->set_value(atlas);
+        return future;
+    }
+
+    _pending[key] = future;
+
+    static ShutdownAtExit shutdownAtExit;
+
+    // The thread only touches the promise, the finished atlas is moved into the cache by the next caller
+    std::shared_ptr<FontRegistry::Face> source = sources.front();
+    sources.erase(sources.begin());
+    Build build;
+    build.future = future;
+    build.thread = std::thread([source, pixelSize, mode, sources, promise]() {
+        promise->set_value(FontAtlas::build(source, pixelSize, mode, sources));
+    });
+    _builds.push_back(std::move(build));
+
+    return future;
+}
+
+std::shared_ptr<FontAtlas> FontAtlasCache::getNearest(FT_Face face, int pixelSize, FontAtlas::RenderMode mode,
+                                                      const std::vector<FT_Face>& fallbacks) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    collect();
+
+    std::vector<std::shared_ptr<FontRegistry::Face>> sources;
+    Key key = makeKey(face, pixelSize, mode, fallbacks, sources);
+
+    std::shared_ptr<FontAtlas> nearest;
+    for(const auto& entry : _atlases) {
+        if(std::get<0>(entry.first) != std::get<0>(key) || std::get<2>(entry.first) != mode ||
+           std::get<3>(entry.first) != std::get<3>(key))
+            continue;
+
+        std::shared_ptr<FontAtlas> atlas = entry.second.lock();
+        if(atlas && (!nearest || std::abs(atlas->getPixelSize() - pixelSize) < std::abs(nearest->getPixelSize() - pixelSize)))
+            nearest = atlas;
+    }
+
+    return nearest;
+}
+
+size_t FontAtlasCache::size() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    collect();
+
+    size_t count = 0;
+    for(const auto& entry : _atlases) {
+        if(!entry.second.expired())
+            ++count;
+    }
+
+    return count;
+}
+
+void FontAtlasCache::shutdown() {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // The threads never take the mutex, so they can finish while it is held
+    for(Build& build : _builds)
+        build.thread.join();
+    _builds.clear();
+
+    collect();
+}
+
+void FontAtlasCache::collect() {
+    for(auto it = _pending.begin(); it != _pending.end();) {
+        if(it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            ++it;
+            continue;
+        }
+
+        // Failed builds are dropped, the next request tries again
+        std::shared_ptr<FontAtlas> atlas = it->second.get();
+        if(atlas)
+            _atlases[it->first] = atlas;
+
+        it = _pending.erase(it);
+    }
+
+    // A thread whose atlas is ready is only left releasing its faces
+    for(auto it = _builds.begin(); it != _builds.end();) {
+        if(it->future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            ++it;
+            continue;
+        }
+
+        it->thread.join();
+        it = _builds.erase(it);
+    }
+}
+
+FontAtlasCache::Key FontAtlasCache::makeKey(FT_Face face, int pixelSize, FontAtlas::RenderMode mode,
+                                            const std::vector<FT_Face>& fallbacks,
+                                            std::vector<std::shared_ptr<FontRegistry::Face>>& sources) {
+    sources.clear();
+    sources.push_back(FontRegistry::find(face));
+    for(FT_Face fallback : fallbacks)
+        sources.push_back(FontRegistry::find(fallback));
+
+    std::vector<FaceKey> faces;
+    for(size_t i = 0; i < sources.size(); ++i) {
+        FT_Face handle = i ? fallbacks[i - 1] : face;
+        faces.push_back(sources[i] ? FaceKey(sources[i]->getId(), nullptr) : FaceKey(0, handle));
+    }
+
+    return Key(faces.front(), pixelSize, mode, std::vector<FaceKey>(faces.begin() + 1, faces.end()));
+}
@@ -0,0 +1,54 @@
+#include <GLFont/FontFamily.h>
+#include <GLFont/GLFont.h>
+
+#include <fstream>
+
+FontFamily::FontFamily(std::shared_ptr<GLFont> regular) {
+    setFont(Regular, regular);
+}
+
+FontFamily::FontFamily(const std::string& directory, const std::string& name) {
+    static const char* suffixes[BoldItalic + 1] = {"-Regular.ttf", "-Bold.ttf", "-Italic.ttf", "-BoldItalic.ttf"};
+
+    for(int style = Regular; style <= BoldItalic; ++style) {
+        std::string fontFile = directory + "/" + name + suffixes[style];
+
+        // Missing styles are resolved to the closest one by getFont()
+        if(style != Regular && !std::ifstream(fontFile).good())
+            continue;
+
+        _fonts[style] = std::shared_ptr<GLFont>(new GLFont(fontFile));
+    }
+}
+
+void FontFamily::setFont(Style style, std::shared_ptr<GLFont> font) {
+    _fonts[style] = font;
+}
+
+std::shared_ptr<GLFont> FontFamily::getFont(Style style) {
+    if(_fonts[style])
+        return _fonts[style];
+
+    if(style == BoldItalic && _fonts[Bold])
+        return _fonts[Bold];
+    if(style == BoldItalic && _fonts[Italic])
+        return _fonts[Italic];
+
+    return _fonts[Regular];
+}
+
+void FontFamily::addFallback(std::shared_ptr<GLFont> font) {
+    _fallbacks.push_back(font);
+}
+
+const std::vector<std::shared_ptr<GLFont>>& FontFamily::getFallbacks() {
+    return _fallbacks;
+}
+
+std::vector<FT_Face> FontFamily::getFallbackFaces() {
+    std::vector<FT_Face> faces;
+    for(const std::shared_ptr<GLFont>& font : _fallbacks)
+        faces.push_back(font->getFaceHandle());
+
+    return faces;
+}
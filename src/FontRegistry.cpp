@@ -0,0 +1,119 @@
+#include <GLFont/FontRegistry.h>
+#include <GLFont/MappedFile.h>
+
+#include <stdexcept>
+
+std::map<FontRegistry::Key, std::weak_ptr<FontRegistry::Face>> FontRegistry::_faces;
+std::map<FT_Face, std::weak_ptr<FontRegistry::Face>> FontRegistry::_handles;
+std::map<std::string, std::weak_ptr<MappedFile>> FontRegistry::_files;
+std::weak_ptr<FT_LibraryRec_> FontRegistry::_library;
+uint64_t FontRegistry::_nextId = 1;
+std::mutex FontRegistry::_mutex;
+
+FontRegistry::Face::~Face() {
+    // The library is released after the face, when the members are destroyed
+    std::lock_guard<std::mutex> lock(FontRegistry::_mutex);
+    FontRegistry::_handles.erase(_face);
+    FT_Done_Face(_face);
+}
+
+const unsigned char* FontRegistry::Face::getData() {
+    return _file->getData();
+}
+
+size_t FontRegistry::Face::getSize() {
+    return _file->getSize();
+}
+
+std::shared_ptr<FontRegistry::Face> FontRegistry::open(const std::string& fontFile, long faceIndex) {
+    // Declared before the lock: if it ends up owning the last reference, the face is closed after unlocking
+    std::shared_ptr<Face> face;
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    Key key(fontFile, faceIndex);
+    face = _faces[key].lock();
+    if(face)
+        return face;
+
+    // Drop entries whose faces or files have already been closed
+    for(auto it = _faces.begin(); it != _faces.end();) {
+        if(it->second.expired() && it->first != key)
+            it = _faces.erase(it);
+        else
+            ++it;
+    }
+
+    for(auto it = _files.begin(); it != _files.end();) {
+        if(it->second.expired() && it->first != fontFile)
+            it = _files.erase(it);
+        else
+            ++it;
+    }
+
+    // Share one library between all the faces
+    std::shared_ptr<FT_LibraryRec_> library = _library.lock();
+    if(!library) {
+        FT_Library handle;
+        if(FT_Init_FreeType(&handle))
+            throw std::runtime_error("Failed to initialize FreeType");
+
+        library = std::shared_ptr<FT_LibraryRec_>(handle, FT_Done_FreeType);
+        _library = library;
+    }
+
+    // Several faces of a font collection share the mapping of the file
+    std::shared_ptr<MappedFile> file = _files[fontFile].lock();
+    if(!file) {
+        file = std::shared_ptr<MappedFile>(new MappedFile(fontFile));
+        _files[fontFile] = file;
+    }
+
+    FT_Face handle;
+    FT_Error error = FT_New_Memory_Face(library.get(),                            // FreeType instance handle
+                                        file->getData(),                          // Font file contents
+                                        static_cast<FT_Long>(file->getSize()),
+                                        faceIndex,                                // index of the face in the file
+                                        &handle);                                 // font face handle
+
+    if(error == FT_Err_Unknown_File_Format) {
+        throw std::runtime_error("Failed to open font: unknown font format");
+    }
+    else if(error) {
+        throw std::runtime_error("Failed to open font");
+    }
+
+    face = std::shared_ptr<Face>(new Face());
+    face->_library = library;
+    face->_file = file;
+    face->_face = handle;
+    face->_fontFile = fontFile;
+    face->_id = _nextId++;
+    _faces[key] = face;
+    _handles[handle] = face;
+
+    return face;
+}
+
+std::shared_ptr<FontRegistry::Face> FontRegistry::find(FT_Face face) {
+    // Only the matching face is locked, and it is released after unlocking: closing a face takes the mutex too
+    std::shared_ptr<Face> found;
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    auto it = _handles.find(face);
+    if(it != _handles.end())
+        found = it->second.lock();
+
+    return found;
+}
+
+size_t FontRegistry::size() {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    size_t count = 0;
+    for(const auto& entry : _faces) {
+        if(!entry.second.expired())
+            ++count;
+    }
+
+    return count;
+}
@@ -1,10 +1,55 @@
 #include <GLFont/GLUtils.h>
 #include <algorithm>
+#include <atomic>
 #include <fstream>
 #include <sstream>
 #include <vector>
 #include <stdexcept>
 
+#if defined(_WIN32)
+ #include <windows.h>
+#elif defined(__APPLE__)
+ #include <OpenGL/OpenGL.h>
+#elif defined(__linux__)
+ #include <dlfcn.h>
+#endif
+
+#if defined(__linux__)
+namespace {
+
+typedef void* (*GetCurrentContext)();
+
+// Find a function of a window system library the process already loaded, without linking to it: applications use
+// either GLX or EGL (e.g. GLFW on X11 or Wayland, headless contexts), and with GLVND the GL library has neither
+GetCurrentContext findLoaded(const char* const* libraries, const char* function) {
+    for(; *libraries; ++libraries) {
+        void* library = dlopen(*libraries, RTLD_LAZY | RTLD_NOLOAD);
+        if(!library)
+            continue;
+
+        void* symbol = dlsym(library, function);
+        dlclose(library); // only drops the reference taken by dlopen, the library stays loaded
+        if(symbol)
+            return reinterpret_cast<GetCurrentContext>(symbol);
+    }
+
+    return reinterpret_cast<GetCurrentContext>(dlsym(RTLD_DEFAULT, function));
+}
+
+// Resolved on first use, once the library is loaded
+GetCurrentContext lookup(std::atomic<GetCurrentContext>& cache, const char* const* libraries, const char* function) {
+    GetCurrentContext getter = cache.load(std::memory_order_relaxed);
+    if(!getter) {
+        getter = findLoaded(libraries, function);
+        cache.store(getter, std::memory_order_relaxed);
+    }
+
+    return getter;
+}
+
+}
+#endif
+
 GLUtils::GLUtils() {}
 
 
@@ -48,3 +93,28 @@ void GLUtils::loadShader(const std::string& shaderSource, GLenum shaderType, GLu
 
     glDeleteShader(shaderId);
 }
+
+void* GLUtils::getCurrentContext() {
+#if defined(_WIN32)
+    return wglGetCurrentContext();
+#elif defined(__APPLE__)
+    return CGLGetCurrentContext();
+#elif defined(__linux__)
+    static const char* const glxLibraries[] = {"libGLX.so.0", "libGL.so.1", nullptr};
+    static const char* const eglLibraries[] = {"libEGL.so.1", nullptr};
+    static std::atomic<GetCurrentContext> glxGetter(nullptr);
+    static std::atomic<GetCurrentContext> eglGetter(nullptr);
+
+    // GLX returns no context when the current one was made with EGL
+    GetCurrentContext getter = lookup(glxGetter, glxLibraries, "glXGetCurrentContext");
+    void* context = getter ? getter() : nullptr;
+    if(!context) {
+        getter = lookup(eglGetter, eglLibraries, "eglGetCurrentContext");
+        context = getter ? getter() : nullptr;
+    }
+
+    return context;
+#else
+    return nullptr;
+#endif
+}
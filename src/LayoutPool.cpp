@@ -0,0 +1,136 @@
+#include <GLFont/LayoutPool.h>
+#include <GLFont/FTLabel.h>
+#include <GLFont/FontAtlas.h>
+#include <GLFont/Utf8.h>
+
+#include <algorithm>
+#include <map>
+
+LayoutPool::LayoutPool(unsigned threads) :
+  _taskSize(0),
+  _nextIndex(0),
+  _generation(0),
+  _busy(0),
+  _stop(false)
+{
+    if(!threads)
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    // The calling thread takes a share of every task, so it counts as one of the threads
+    for(unsigned i = 1; i < threads; ++i)
+        _threads.push_back(std::thread(&LayoutPool::work, this));
+}
+
+LayoutPool::~LayoutPool() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _wake.notify_all();
+
+    for(std::thread& thread : _threads)
+        thread.join();
+}
+
+void LayoutPool::update(const std::vector<FTLabel*>& labels) {
+    // Atlases are switched on this thread, and labels that cannot be laid out in parallel are left for the end
+    _parallel.clear();
+    for(FTLabel* label : labels) {
+        label->updateAtlas();
+        if(label->hasParallelLayout() && (label->_dirty & FTLabel::LayoutDirty))
+            _parallel.push_back(label);
+    }
+
+    // Find the codepoints missing from the atlases. Workers only read the atlases, so it is safe to share them
+    if(_missing.size() < _parallel.size())
+        _missing.resize(_parallel.size());
+
+    parallelFor(_parallel.size(), [this](size_t i) {
+        FTLabel* label = _parallel[i];
+        std::vector<uint32_t>& missing = _missing[i];
+        missing.clear();
+
+        const char* p = label->_text.data();
+        const char* end = p + label->_text.size();
+        while(uint32_t codepoint = Utf8::next(p, end)) {
+            if(!label->_fontAtlas->hasGlyph(codepoint))
+                missing.push_back(codepoint);
+        }
+    });
+
+    // Rasterize them in one go per atlas (itself spread over several threads), so that layout does not add glyphs
+    std::map<FontAtlas*, std::vector<uint32_t>> preloads;
+    for(size_t i = 0; i < _parallel.size(); ++i) {
+        if(!_missing[i].empty()) {
+            std::vector<uint32_t>& codepoints = preloads[_parallel[i]->_fontAtlas.get()];
+            codepoints.insert(codepoints.end(), _missing[i].begin(), _missing[i].end());
+        }
+    }
+
+    for(auto& preload : preloads)
+        preload.first->preload(preload.second);
+
+    parallelFor(_parallel.size(), [this](size_t i) {
+        _parallel[i]->updateGeometry();
+    });
+
+    // Uploads, and the labels laying out with GL, committed the way render() does
+    for(FTLabel* label : labels)
+        label->update();
+}
+
+void LayoutPool::parallelFor(size_t count, const std::function<void(size_t)>& task) {
+    if(!count)
+        return;
+
+    // Not worth waking the workers for a single item
+    if(count == 1 || _threads.empty()) {
+        for(size_t i = 0; i < count; ++i)
+            task(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _task = task;
+        _taskSize = count;
+        _nextIndex = 0;
+        _busy = static_cast<unsigned>(_threads.size());
+        ++_generation;
+    }
+    _wake.notify_all();
+
+    runTask();
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _done.wait(lock, [this]() { return !_busy; });
+    _task = nullptr;
+}
+
+void LayoutPool::runTask() {
+    // Items are handed out one at a time, labels vary a lot in length
+    for(size_t i = _nextIndex++; i < _taskSize; i = _nextIndex++)
+        _task(i);
+}
+
+void LayoutPool::work() {
+    unsigned generation = 0;
+
+    while(true) {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [this, generation]() { return _stop || _generation != generation; });
+            if(_stop)
+                return;
+            generation = _generation;
+        }
+
+        runTask();
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            --_busy;
+        }
+        _done.notify_one();
+    }
+}
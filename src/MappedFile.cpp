@@ -0,0 +1,82 @@
+#include <GLFont/MappedFile.h>
+
+#include <stdexcept>
+
+#if defined(_WIN32)
+ #include <windows.h>
+#else
+ #include <fcntl.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+
+MappedFile::MappedFile(const std::string& path) :
+  _data(nullptr),
+  _size(0),
+  _file(INVALID_HANDLE_VALUE),
+  _mapping(NULL)
+{
+    _file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(_file == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("Failed to open " + path);
+
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(_file, &size) || size.QuadPart == 0) {
+        CloseHandle(_file);
+        throw std::runtime_error("Failed to map " + path + ": empty file");
+    }
+    _size = static_cast<size_t>(size.QuadPart);
+
+    _mapping = CreateFileMappingA(_file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if(_mapping)
+        _data = static_cast<const unsigned char*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+
+    if(!_data) {
+        if(_mapping)
+            CloseHandle(_mapping);
+        CloseHandle(_file);
+        throw std::runtime_error("Failed to map " + path);
+    }
+}
+
+MappedFile::~MappedFile() {
+    UnmapViewOfFile(_data);
+    CloseHandle(_mapping);
+    CloseHandle(_file);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path) :
+  _data(nullptr),
+  _size(0)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+        throw std::runtime_error("Failed to open " + path);
+
+    struct stat st;
+    if(fstat(fd, &st) || st.st_size == 0) {
+        close(fd);
+        throw std::runtime_error("Failed to map " + path + ": empty file");
+    }
+    _size = static_cast<size_t>(st.st_size);
+
+    // The mapping stays valid once the descriptor is closed
+    void* data = mmap(NULL, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(data == MAP_FAILED)
+        throw std::runtime_error("Failed to map " + path);
+
+    _data = static_cast<const unsigned char*>(data);
+}
+
+MappedFile::~MappedFile() {
+    munmap(const_cast<unsigned char*>(_data), _size);
+}
+
+#endif
@@ -0,0 +1,41 @@
+#include <GLFont/ShaderProgram.h>
+#include <GLFont/GLUtils.h>
+
+std::map<ShaderProgram::Key, std::weak_ptr<ShaderProgram>> ShaderProgram::_programs;
+std::mutex ShaderProgram::_mutex;
+
+ShaderProgram::ShaderProgram(const char* vertexSource, const char* fragmentSource) {
+    _programId = glCreateProgram();
+
+    GLUtils::loadShader(vertexSource, GL_VERTEX_SHADER, _programId);
+    GLUtils::loadShader(fragmentSource, GL_FRAGMENT_SHADER, _programId);
+}
+
+ShaderProgram::~ShaderProgram() {
+    glDeleteProgram(_programId);
+}
+
+GLint ShaderProgram::getUniformLocation(const std::string& name) {
+    auto it = _uniforms.find(name);
+    if(it != _uniforms.end())
+        return it->second;
+
+    GLint location = glGetUniformLocation(_programId, name.c_str());
+    _uniforms[name] = location;
+
+    return location;
+}
+
+std::shared_ptr<ShaderProgram> ShaderProgram::get(const std::string& name, const char* vertexSource, const char* fragmentSource) {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // GL objects cannot be used across contexts (unless they share lists), so programs are registered per context
+    Key key(GLUtils::getCurrentContext(), name);
+    std::shared_ptr<ShaderProgram> program = _programs[key].lock();
+    if(!program) {
+        program = std::shared_ptr<ShaderProgram>(new ShaderProgram(vertexSource, fragmentSource));
+        _programs[key] = program;
+    }
+
+    return program;
+}
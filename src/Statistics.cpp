@@ -0,0 +1,41 @@
+#include <GLFont/Statistics.h>
+
+std::atomic<int64_t> Statistics::_counters[CounterCount];
+
+Statistics::Counters Statistics::Counters::operator-(const Counters& other) const {
+    Counters difference;
+    for(int i = 0; i < CounterCount; ++i)
+        difference.values[i] = values[i] - other.values[i];
+
+    return difference;
+}
+
+Statistics::Counters Statistics::snapshot() {
+    Counters counters;
+    for(int i = 0; i < CounterCount; ++i)
+        counters.values[i] = _counters[i].load(std::memory_order_relaxed);
+
+    return counters;
+}
+
+void Statistics::reset() {
+    for(int i = 0; i < CounterCount; ++i) {
+        if(i != AtlasTextureBytes)
+            _counters[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+const char* Statistics::getName(Counter counter) {
+    static const char* names[CounterCount] = {
+        "relayouts",
+        "vertices",
+        "bytes_uploaded",
+        "draw_calls",
+        "gpu_ns",
+        "atlas_builds",
+        "atlas_build_ns",
+        "atlas_texture_bytes"
+    };
+
+    return counter >= 0 && counter < CounterCount ? names[counter] : "unknown";
+}
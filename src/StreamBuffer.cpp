@@ -0,0 +1,134 @@
+#include <GLFont/StreamBuffer.h>
+
+#include <algorithm>
+#include <cstring>
+
+static inline size_t align(size_t offset, size_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+StreamBuffer::StreamBuffer(GLenum target, Mode mode) :
+  _target(target),
+  _mode(mode),
+  _buffer(0),
+  _capacity(0),
+  _mapped(nullptr),
+  _head(0),
+  _segment(0)
+{
+    for(int i = 0; i < NumSegments; ++i)
+        _fences[i] = 0;
+
+    if(_mode == PersistentRing && !isPersistentMappingSupported()) {
+        fprintf(stderr, "Persistent buffer mapping is not supported, falling back to buffer orphaning\n");
+        _mode = Orphaning;
+    }
+
+    glGenBuffers(1, &_buffer);
+}
+
+StreamBuffer::~StreamBuffer() {
+    if(_mode == PersistentRing)
+        releaseRing();
+
+    glDeleteBuffers(1, &_buffer);
+}
+
+bool StreamBuffer::isPersistentMappingSupported() {
+    return GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+}
+
+size_t StreamBuffer::upload(const void* data, size_t size, size_t alignment) {
+    if(size == 0)
+        return 0;
+
+    if(_mode == Orphaning) {
+        glBindBuffer(_target, _buffer);
+
+        // Grow geometrically, so that a slowly growing label does not reallocate on every change.
+        // Respecifying the storage with NULL orphans the old contents: the driver hands us fresh memory
+        // instead of waiting for the draws that still read the previous data
+        if(size > _capacity)
+            _capacity = std::max(size, 2 * _capacity);
+        glBufferData(_target, _capacity, NULL, GL_STREAM_DRAW);
+        glBufferSubData(_target, 0, size, data);
+
+        glBindBuffer(_target, 0);
+        return 0;
+    }
+
+    // Every upload has to fit in a single segment, otherwise it could overwrite data still in flight
+    size_t segmentSize = _capacity / NumSegments;
+    if(size + alignment > segmentSize) {
+        size_t capacity = std::max(_capacity * 2, (size + alignment) * NumSegments);
+        releaseRing();
+        glDeleteBuffers(1, &_buffer);
+        glGenBuffers(1, &_buffer);
+        allocateRing(capacity);
+        segmentSize = _capacity / NumSegments;
+    }
+
+    // Uploads never straddle two segments, so that a single fence covers every draw reading a segment
+    int segment = _segment;
+    size_t offset = align(_head, alignment);
+    if(offset + size > (segment + 1) * segmentSize) {
+        segment = (segment + 1) % NumSegments;
+        offset = align(segment * segmentSize, alignment);
+    }
+
+    if(segment != _segment) {
+        // We are leaving the current segment: fence the draws issued so far, which are the ones reading from it
+        if(_fences[_segment])
+            glDeleteSync(_fences[_segment]);
+        _fences[_segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+        waitSegment(segment);
+        _segment = segment;
+    }
+
+    std::memcpy(_mapped + offset, data, size);
+    _head = offset + size;
+
+    return offset;
+}
+
+void StreamBuffer::allocateRing(size_t capacity) {
+    _capacity = capacity;
+    _head = 0;
+    _segment = 0;
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    glBindBuffer(_target, _buffer);
+    glBufferStorage(_target, _capacity, NULL, flags);
+    _mapped = static_cast<unsigned char*>(glMapBufferRange(_target, 0, _capacity, flags));
+    glBindBuffer(_target, 0);
+}
+
+void StreamBuffer::releaseRing() {
+    for(int i = 0; i < NumSegments; ++i) {
+        if(_fences[i]) {
+            glDeleteSync(_fences[i]);
+            _fences[i] = 0;
+        }
+    }
+
+    if(_mapped) {
+        glBindBuffer(_target, _buffer);
+        glUnmapBuffer(_target);
+        glBindBuffer(_target, 0);
+        _mapped = nullptr;
+    }
+}
+
+void StreamBuffer::waitSegment(int segment) {
+    if(!_fences[segment])
+        return;
+
+    GLenum result = glClientWaitSync(_fences[segment], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    while(result == GL_TIMEOUT_EXPIRED)
+        result = glClientWaitSync(_fences[segment], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); // 1 ms
+
+    glDeleteSync(_fences[segment]);
+    _fences[segment] = 0;
+}
@@ -0,0 +1,133 @@
+#include <GLFont/TextBatch.h>
+#include <GLFont/FTLabel.h>
+#include <GLFont/FontAtlas.h>
+#include <GLFont/ShaderProgram.h>
+#include <GLFont/Statistics.h>
+
+#include <algorithm>
+#include <string>
+
+TextBatch::TextBatch() :
+  // The batch is rewritten every frame, which is what persistently mapped ring buffers are best at
+  _vertexBuffer(GL_ARRAY_BUFFER, StreamBuffer::isPersistentMappingSupported() ? StreamBuffer::PersistentRing
+                                                                                : StreamBuffer::Orphaning)
+{
+    static const char* batchVertexSource =
+        #include <GLFont/shaders/batchVertex.shader>
+        ;
+
+    static const char* batchFragmentSource =
+        #include <GLFont/shaders/batchFragment.shader>
+        ;
+
+    _program = ShaderProgram::get("batch", batchVertexSource, batchFragmentSource);
+
+    glGenVertexArrays(1, &_vao);
+    glBindVertexArray(_vao);
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+    glBindVertexArray(0);
+}
+
+TextBatch::~TextBatch() {
+    glDeleteVertexArrays(1, &_vao);
+}
+
+void TextBatch::add(FTLabel& label) {
+    if(label._coords.empty())
+        return;
+
+    FontAtlas& atlas = *label._fontAtlas;
+    std::vector<Vertex>& vertices = _vertices[std::make_pair(atlas.getRenderMode(), atlas.getTexId())];
+    vertices.reserve(vertices.size() + label._coords.size());
+
+    // Apply the label transform on the CPU so that labels with different MVPs can share a draw call
+    for(const FTLabel::Point& p : label._coords) {
+        glm::vec4 pos = label._mvp * glm::vec4(p.x, p.y, 0, 1);
+        vertices.push_back(Vertex(pos.x / pos.w, pos.y / pos.w, p.s, p.t, p.layer, label._textColor));
+    }
+}
+
+void TextBatch::render() {
+    _stream.clear();
+    _ranges.clear();
+
+    // Concatenate the per-atlas vertices so that the whole frame is uploaded at once
+    for(auto& entry : _vertices) {
+        if(entry.second.empty())
+            continue;
+
+        Range range;
+        range.mode = entry.first.first;
+        range.texture = entry.first.second;
+        range.first = static_cast<GLint>(_stream.size());
+        range.count = static_cast<GLsizei>(entry.second.size());
+        _ranges.push_back(range);
+
+        _stream.insert(_stream.end(), entry.second.begin(), entry.second.end());
+        entry.second.clear();
+    }
+
+    if(_ranges.empty())
+        return;
+
+    // Distance field ranges sort last
+    if(_ranges.back().mode == FontAtlas::DistanceField && !_distanceFieldProgram) {
+        static const char* batchVertexSource =
+            #include <GLFont/shaders/batchVertex.shader>
+            ;
+
+        static const char* batchDistanceFieldFragmentSource =
+            #include <GLFont/shaders/batchDistanceFieldFragment.shader>
+            ;
+
+        _distanceFieldProgram = ShaderProgram::get("batchDistanceField", batchVertexSource, batchDistanceFieldFragmentSource);
+    }
+
+    glBindVertexArray(_vao);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    // Upload the whole frame at once. The vertices land at an arbitrary (vertex aligned) offset of the ring
+    size_t offset = _vertexBuffer.upload(_stream.data(), _stream.size() * sizeof(Vertex), sizeof(Vertex));
+    GLint firstVertex = static_cast<GLint>(offset / sizeof(Vertex));
+
+    // The ring may have been reallocated by the upload, so point the attributes at the current buffer
+    glBindBuffer(GL_ARRAY_BUFFER, _vertexBuffer.getBufferId());
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), 0);
+    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(4 * sizeof(GLfloat)));
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(5 * sizeof(GLfloat)));
+
+    glActiveTexture(GL_TEXTURE0);
+
+    // Ranges are sorted by render mode, so the program changes at most once
+    ShaderProgram* current = nullptr;
+    for(const Range& range : _ranges) {
+        ShaderProgram* program = range.mode == FontAtlas::DistanceField ? _distanceFieldProgram.get() : _program.get();
+        if(program != current) {
+            glUseProgram(program->getProgramId());
+            glUniform1i(program->getUniformLocation("tex"), 0);
+            current = program;
+        }
+
+        glBindTexture(GL_TEXTURE_2D_ARRAY, range.texture);
+        glDrawArrays(GL_TRIANGLES, firstVertex + range.first, range.count);
+    }
+
+    // The draws are shared by the labels of the batch, so they are only counted globally
+    Statistics::add(Statistics::DrawCalls, static_cast<int64_t>(_ranges.size()));
+    Statistics::add(Statistics::BytesUploaded, static_cast<int64_t>(_stream.size() * sizeof(Vertex)));
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glDisable(GL_BLEND);
+    glUseProgram(0);
+    glBindVertexArray(0);
+}
+
+void TextBatch::clear() {
+    for(auto& entry : _vertices)
+        entry.second.clear();
+}
@@ -0,0 +1,204 @@
+#include <GLFont/TextLayout.h>
+#include <GLFont/Utf8.h>
+
+#include <cmath>
+#include <cstring>
+
+TextLayout::TextLayout() :
+  _metrics(nullptr),
+  _scale(1.0f),
+  _arsx(1.0f),
+  _arsy(1.0f),
+  _maxWidth(0),
+  _maxHeight(0),
+  _alignment(Left),
+  _indentation(0),
+  _width(0)
+{}
+
+void TextLayout::setMetrics(GlyphMetrics* metrics) {
+    _metrics = metrics;
+}
+
+void TextLayout::setScale(float scale) {
+    _scale = scale;
+}
+
+void TextLayout::setAspectRatio(float x, float y) {
+    _arsx = x;
+    _arsy = y;
+}
+
+void TextLayout::setMaxSize(int width, int height) {
+    _maxWidth = width;
+    _maxHeight = height;
+}
+
+void TextLayout::setAlignment(Alignment alignment) {
+    _alignment = alignment;
+}
+
+void TextLayout::setIndentation(int pixels) {
+    _indentation = pixels;
+}
+
+float TextLayout::getLineHeight() {
+    return _metrics->getLineHeight() * _scale * _arsy;
+}
+
+void TextLayout::layout(std::string_view text, float x, float y) {
+    _glyphs.clear();
+    _width = 0;
+
+    breakLines(text);
+
+    // Keep the lines fitting entirely in the maximum height
+    float lineHeight = getLineHeight();
+    size_t lines = 0;
+    float bottom = y + lineHeight;
+    while(lines < _lines.size() && (bottom - y <= _maxHeight || !_maxHeight)) {
+        bottom += lineHeight;
+        ++lines;
+    }
+    _lines.resize(lines);
+
+    int indent = _indentation;
+    for(Line& line : _lines) {
+        line.x = x + indent;
+        line.y = y;
+        line.baseline = y + lineHeight;
+
+        if(_alignment == Center)
+            line.x -= line.width / 2.0;
+        else if(_alignment == Right)
+            line.x -= line.width;
+
+        placeLine(line, line.x, line.baseline);
+        y += lineHeight;
+        indent = 0;
+
+        if(line.width > _width)
+            _width = line.width;
+    }
+}
+
+void TextLayout::breakLines(std::string_view text) {
+    _measured.clear();
+    _lines.clear();
+
+    // Embedded null characters end the text
+    text = text.substr(0, text.find('\0'));
+    const char* end = text.data() + text.size();
+
+    // Widths are summed in whole pixels per glyph, then scaled by the aspect ratio
+    auto pixels = [this](float advance) { return static_cast<int>(std::ceil(advance * _scale)); };
+    int spaceWidth = static_cast<int>(pixels(_metrics->getAdvanceX(_metrics->getGlyphIndex(' '))) * _arsx);
+
+    Line line = {std::string_view(), 0, 0, 0, 0, 0, 0};
+    const char* lineBegin = text.data();
+    int lineWidth = 0; // unscaled
+    int joinWidth = 0; // kerning of the last word of the line with the next word, if it joins the line
+    int widthRemaining = _maxWidth;
+
+    // Each word, up to and including a space, is measured once and then placed on the current line or a new one
+    const char* wordBegin = text.data();
+    while(wordBegin < end) {
+        // Spaces are never part of a multibyte sequence, so words can be cut before decoding them
+        const char* space = static_cast<const char*>(std::memchr(wordBegin, ' ', end - wordBegin));
+        const char* wordEnd = space ? space + 1 : end;
+
+        size_t wordGlyph = _measured.size();
+        int wordWidth = measureWord(std::string_view(wordBegin, wordEnd - wordBegin)); // unscaled, measured alone
+        int wordJoinWidth = 0;
+
+        // The space ending a word is kerned with the next word only if both end up on the same line
+        if(space && wordEnd < end) {
+            const char* p = wordEnd;
+            float& advance = _measured.back().advance;
+            float kerning = _metrics->getKerning(' ', Utf8::next(p, end));
+
+            wordJoinWidth = pixels(advance + kerning) - pixels(advance);
+            advance += kerning;
+        }
+
+        int scaledWordWidth = static_cast<int>(wordWidth * _arsx);
+        if(scaledWordWidth - spaceWidth > widthRemaining && _maxWidth /* make sure there is a width specified */) {
+            // If we have passed the given width, end this line and start the next one with the current word
+            line.text = std::string_view(lineBegin, wordBegin - lineBegin);
+            line.endGlyph = wordGlyph;
+            line.width = static_cast<int>(lineWidth * _arsx);
+            _lines.push_back(line);
+
+            line.firstGlyph = wordGlyph;
+            lineBegin = wordBegin;
+            lineWidth = wordWidth;
+            widthRemaining = _maxWidth - scaledWordWidth;
+        }
+        else {
+            // Otherwise, add this word to the current line
+            lineWidth += joinWidth + wordWidth;
+            widthRemaining -= scaledWordWidth;
+        }
+
+        joinWidth = wordJoinWidth;
+        wordBegin = wordEnd;
+    }
+
+    // Add the last line
+    if(end > lineBegin) {
+        line.text = std::string_view(lineBegin, end - lineBegin);
+        line.endGlyph = _measured.size();
+        line.width = static_cast<int>(lineWidth * _arsx);
+        _lines.push_back(line);
+    }
+}
+
+int TextLayout::measureWord(std::string_view word) {
+    WordCache* cache = _metrics->getWordCache();
+
+    int width = 0;
+    if(cache && cache->find(word, _scale, _measured, width))
+        return width;
+
+    size_t first = _measured.size();
+    const char* end = word.data() + word.size();
+    const char* p = word.data();
+    uint32_t codepoint = Utf8::next(p, end);
+
+    while(codepoint) {
+        uint32_t nextCodepoint = Utf8::next(p, end);
+
+        // Text is UTF-8, glyphs missing from an atlas are rasterized on the fly
+        unsigned index = _metrics->getGlyphIndex(codepoint);
+        float advance = _metrics->getAdvanceX(index) + _metrics->getKerning(codepoint, nextCodepoint);
+        _measured.push_back(MeasuredGlyph{index, advance});
+        width += static_cast<int>(std::ceil(advance * _scale));
+
+        codepoint = nextCodepoint;
+    }
+
+    if(cache)
+        cache->insert(word, _scale, width, _measured.data() + first, _measured.size() - first);
+
+    return width;
+}
+
+void TextLayout::placeLine(Line& line, float x, float y) {
+    size_t first = _glyphs.size();
+
+    for(size_t i = line.firstGlyph; i < line.endGlyph; ++i) {
+        const MeasuredGlyph& glyph = _measured[i];
+
+        // Skip glyphs with no pixels (e.g. spaces)
+        if(!_metrics->isBlank(glyph.index))
+            _glyphs.push_back(Glyph{glyph.index, x, y});
+
+        // Advance cursor to start of next character
+        x += glyph.advance * _scale;
+        y -= _metrics->getAdvanceY(glyph.index) * _scale * _arsy;
+    }
+
+    // From now on the line refers to its positioned glyphs
+    line.firstGlyph = first;
+    line.endGlyph = _glyphs.size();
+}
@@ -0,0 +1,103 @@
+#include <GLFont/TextMeasure.h>
+#include <GLFont/FontAtlasCache.h>
+#include <GLFont/GLFont.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+bool TextMeasure::Key::operator==(const Key& other) const {
+    return face == other.face && pixelSize == other.pixelSize && maxWidth == other.maxWidth && flags == other.flags &&
+           text == other.text;
+}
+
+size_t TextMeasure::KeyHash::operator()(const Key& key) const {
+    size_t hash = std::hash<std::string_view>()(key.text);
+    size_t values[] = {std::hash<FT_Face>()(key.face), static_cast<size_t>(key.pixelSize),
+                       static_cast<size_t>(key.maxWidth), static_cast<size_t>(key.flags)};
+
+    for(size_t value : values)
+        hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+
+    return hash;
+}
+
+TextMeasure::TextMeasure(size_t capacity) :
+  _capacity(std::max<size_t>(capacity, 1)),
+  _hits(0),
+  _misses(0)
+{}
+
+const TextMeasure::Result& TextMeasure::measure(std::string_view text, const std::shared_ptr<GLFont>& font, int pixelSize,
+                                                int maxWidth, int flags) {
+    flags &= LayoutFlags;
+    Key key = {text, font->getFaceHandle(), pixelSize, maxWidth, flags};
+
+    auto it = _index.find(key);
+    if(it != _index.end()) {
+        // Move to the front, as the most recently used
+        _entries.splice(_entries.begin(), _entries, it->second);
+        ++_hits;
+        return it->second->result;
+    }
+
+    ++_misses;
+
+    // Reuse the least recently used entry when full, instead of allocating a new one
+    if(_entries.size() >= _capacity) {
+        _index.erase(_entries.back().key);
+        _entries.splice(_entries.begin(), _entries, std::prev(_entries.end()));
+    }
+    else {
+        _entries.emplace_front();
+    }
+
+    Entry& entry = _entries.front();
+    entry.text.assign(text.data(), text.size());
+    entry.key = key;
+    entry.key.text = entry.text;
+
+    // Same atlas as a label of this face and pixel size would use
+    Font& f = _fonts[std::make_pair(key.face, pixelSize)];
+    if(!f.atlas) {
+        f.font = font;
+        f.atlas = FontAtlasCache::get(key.face, pixelSize);
+    }
+
+    _layout.setMetrics(f.atlas.get());
+    _layout.setMaxSize(maxWidth, 0);
+
+    if(flags & FTLabel::FontFlags::CenterAligned)
+        _layout.setAlignment(TextLayout::Center);
+    else if(flags & FTLabel::FontFlags::RightAligned)
+        _layout.setAlignment(TextLayout::Right);
+    else
+        _layout.setAlignment(TextLayout::Left);
+
+    _layout.setIndentation((flags & FTLabel::FontFlags::Indented) && !(flags & FTLabel::FontFlags::CenterAligned) ? pixelSize : 0);
+    _layout.layout(entry.text);
+
+    Result& result = entry.result;
+    result.width = _layout.getWidth();
+    result.height = static_cast<int>(std::ceil(_layout.getHeight()));
+    result.lineCount = _layout.getLines().size();
+    result.lines.clear();
+    for(const TextLayout::Line& line : _layout.getLines()) {
+        LineExtents extents;
+        extents.begin = static_cast<size_t>(line.text.data() - entry.text.data());
+        extents.length = line.text.size();
+        extents.x = line.x;
+        extents.y = line.y;
+        extents.width = line.width;
+        result.lines.push_back(extents);
+    }
+
+    _index[entry.key] = _entries.begin();
+    return result;
+}
+
+void TextMeasure::clear() {
+    _index.clear();
+    _entries.clear();
+    _fonts.clear();
+}
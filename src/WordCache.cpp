@@ -0,0 +1,54 @@
+#include <GLFont/WordCache.h>
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+
+bool WordCache::find(std::string_view word, float scale, std::vector<Glyph>& glyphs, int& width) {
+    std::shared_lock<std::shared_mutex> lock(_mutex);
+
+    auto it = _words.find(hash(word, scale));
+    if(it == _words.end() || it->second.scale != scale || it->second.text != word)
+        return false;
+
+    glyphs.insert(glyphs.end(), it->second.glyphs.begin(), it->second.glyphs.end());
+    width = it->second.width;
+    return true;
+}
+
+void WordCache::insert(std::string_view word, float scale, int width, const Glyph* glyphs, size_t count) {
+    std::unique_lock<std::shared_mutex> lock(_mutex);
+
+    if(_words.size() >= MaxWords)
+        _words.clear();
+
+    // Keep the word already cached on hash collisions
+    auto inserted = _words.emplace(hash(word, scale), Word());
+    if(!inserted.second)
+        return;
+
+    Word& w = inserted.first->second;
+    w.text.assign(word.data(), word.size());
+    w.scale = scale;
+    w.width = width;
+    w.glyphs.assign(glyphs, glyphs + count);
+}
+
+void WordCache::clear() {
+    std::unique_lock<std::shared_mutex> lock(_mutex);
+    _words.clear();
+}
+
+size_t WordCache::size() {
+    std::shared_lock<std::shared_mutex> lock(_mutex);
+    return _words.size();
+}
+
+size_t WordCache::hash(std::string_view word, float scale) {
+    uint32_t bits;
+    std::memcpy(&bits, &scale, sizeof(bits));
+
+    size_t hash = std::hash<std::string_view>()(word);
+    return hash ^ (bits + 0x9e3779b9 + (hash << 6) + (hash >> 2));
+}
@@ -0,0 +1,41 @@
+#include "OffscreenWindow.h"
+#include "HeadlessContext.h"
+
+OffscreenWindow::OffscreenWindow(int width, int height) :
+  _width(width),
+  _height(height)
+{}
+
+// Defined here, where HeadlessContext is complete
+OffscreenWindow::~OffscreenWindow() {}
+
+void OffscreenWindow::run(int frames) {
+    _context = std::unique_ptr<HeadlessContext>(new HeadlessContext(_width, _height));
+
+    init();
+
+    for(_frame = 0; _frame < frames; ++_frame) {
+        _context->bindFramebuffer();
+
+        // Render scene
+        glClearColor(0.0, 0.0, 0.0, 0.0);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        update();
+        render();
+    }
+
+    finish();
+}
+
+void OffscreenWindow::resize(int width, int height) {
+    _width = width;
+    _height = height;
+
+    if(_context)
+        _context->resize(width, height);
+
+    onResize(width, height);
+}
+
+void OffscreenWindow::onResize(int width, int height) {}
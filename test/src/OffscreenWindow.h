@@ -0,0 +1,48 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+#include <memory>
+
+#include "stdio.h"
+#include "stdlib.h"
+
+class HeadlessContext;
+
+// Same structure as GLWindow, without a display: the context is a HeadlessContext (EGL, surfaceless Mesa works on
+// machines without a GPU or X server) and frames are drawn into its offscreen framebuffer, for a fixed number of frames
+class OffscreenWindow {
+public:
+    OffscreenWindow(int width, int height);
+    ~OffscreenWindow();
+
+    // Create the context, then init() and draw the frames, waiting for each to complete
+    void run(int frames);
+
+    inline int getWidth() { return _width; }
+    inline int getHeight() { return _height; }
+
+protected:
+    virtual void init() = 0;
+    // For state changes
+    virtual void update() = 0;
+    // Render the scene
+    virtual void render() = 0;
+    // Called after the last frame, before the context is destroyed
+    virtual void finish() {}
+
+    // Change the size of the framebuffer, and let the scene know through onResize()
+    void resize(int width, int height);
+    virtual void onResize(int width, int height);
+
+    inline int getFrame() { return _frame; }
+
+private:
+    std::unique_ptr<HeadlessContext> _context;
+    int _frame = 0; // current frame
+
+    // Window size
+    int _width;
+    int _height;
+};
@@ -0,0 +1,193 @@
+#include "StressScene.h"
+#include <GLFont/GLFont.h>
+#include <GLFont/FTFieldLabel.h>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+namespace {
+
+const char* Words[] = {
+    "joint_position", "velocity", "torque", "effort", "OK", "WARNING", "l_shoulder_pitch", "r_knee", "temperature",
+    "battery", "connected", "idle", "running", "l_hip_roll", "r_ankle_pitch", "neck_yaw"
+};
+
+const int FieldCount = 32;
+const int FieldSlots = 10;
+
+double seconds(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration<double>(duration).count();
+}
+
+// Value below which a fraction of the sorted samples are
+double percentile(const vector<double>& sorted, double fraction) {
+    if(sorted.empty())
+        return 0;
+
+    size_t index = static_cast<size_t>(std::ceil(fraction * sorted.size()));
+    return sorted[std::min(std::max<size_t>(index, 1), sorted.size()) - 1];
+}
+
+}
+
+StressScene::StressScene(int width, int height, int labelCount, bool gpuTiming) :
+  OffscreenWindow(width, height),
+  _labelCount(labelCount),
+  _gpuTiming(gpuTiming),
+  _initialWidth(width),
+  _initialHeight(height)
+{}
+
+StressScene::~StressScene() {}
+
+void StressScene::init() {
+    _font = shared_ptr<GLFont>(new GLFont(GLFont::DefaultFontsPathPrefix() + "Roboto/Roboto-Regular.ttf"));
+
+    // Static labels, e.g. the names and units of a dashboard
+    for(int i = 0; i < _labelCount; ++i) {
+        std::string text = std::string(Words[i % 16]) + " " + std::to_string(i);
+        shared_ptr<FTLabel> label(new FTLabel(_font, text, 0, 0, getWidth(), getHeight()));
+        label->setPixelSize(12);
+        label->setColor(0.8, 0.8, 0.8, 1.0);
+        _labels.push_back(label);
+        _all.push_back(label.get());
+    }
+
+    // Long paragraph scrolling up, laid out again every frame
+    std::string text;
+    for(int i = 0; i < 200; ++i)
+        text += std::string(Words[(i * 7) % 16]) + (i % 11 == 10 ? ". " : " ");
+    _paragraph = shared_ptr<FTLabel>(new FTLabel(_font, text, 0, 0, getWidth() / 3, 0, getWidth(), getHeight()));
+    _paragraph->setPixelSize(16);
+    _paragraph->setColor(0, 1.0, 0.5, 1.0);
+    _all.push_back(_paragraph.get());
+
+    // Telemetry changing every frame
+    for(int i = 0; i < FieldCount; ++i) {
+        shared_ptr<FTFieldLabel> field(new FTFieldLabel(_font, 0, 0, FieldSlots, getWidth(), getHeight()));
+        field->setPixelSize(14);
+        field->setColor(1.0, 0.8, 0.2, 1.0);
+        field->setAlignment(FTLabel::FontFlags::RightAligned);
+        _fields.push_back(field);
+        _all.push_back(field.get());
+    }
+
+    for(FTLabel* label : _all)
+        label->setGpuTiming(_gpuTiming);
+
+    layoutScene();
+    _frameTimes.reserve(1024);
+    _initCounters = Statistics::snapshot();
+}
+
+void StressScene::layoutScene() {
+    int width = getWidth();
+    int height = getHeight();
+
+    // Grid of static labels on the left two thirds
+    int columns = 8;
+    int rows = std::max((_labelCount + columns - 1) / columns, 1);
+    float cellWidth = 2.0f * width / 3 / columns;
+    float cellHeight = static_cast<float>(height) / rows;
+    for(int i = 0; i < _labelCount; ++i)
+        _labels[i]->setPosition((i % columns) * cellWidth, (i / columns) * cellHeight);
+
+    _paragraph->setMaxSize(width / 3, 0);
+
+    for(int i = 0; i < FieldCount; ++i)
+        _fields[i]->setPosition(width - 10, i * 20);
+}
+
+void StressScene::update() {
+    _frameStart = Clock::now();
+    int frame = getFrame();
+
+    // Shrink and grow the window periodically, which changes the layout of every label
+    if(frame && frame % ResizePeriod == 0) {
+        bool small = (frame / ResizePeriod) % 2;
+        resize(small ? _initialWidth * 3 / 4 : _initialWidth, small ? _initialHeight * 3 / 4 : _initialHeight);
+    }
+
+    _paragraph->setPosition(2.0f * getWidth() / 3, getHeight() - (frame % 600) * 2.0f);
+
+    for(int i = 0; i < FieldCount; ++i)
+        _fields[i]->setNumber(std::sin(0.05 * frame + i) * 1000.0, 3);
+}
+
+void StressScene::render() {
+    Clock::time_point start = Clock::now();
+
+    // Measuring forces the layout, without generating quads or uploading
+    for(FTLabel* label : _all)
+        label->getCurrentLabelWidth();
+    Clock::time_point laidOut = Clock::now();
+
+    for(FTLabel* label : _all)
+        label->update();
+    Clock::time_point uploaded = Clock::now();
+
+    // Every label is up to date, so this only draws
+    for(FTLabel* label : _all)
+        label->render();
+    Clock::time_point drawn = Clock::now();
+
+    // Wait for the GPU, so that frame times include drawing
+    glFinish();
+
+    _layoutTime += seconds(laidOut - start);
+    _uploadTime += seconds(uploaded - laidOut);
+    _drawTime += seconds(drawn - uploaded);
+    _frameTimes.push_back(seconds(Clock::now() - _frameStart));
+}
+
+void StressScene::onResize(int width, int height) {
+    for(FTLabel* label : _all)
+        label->setWindowSize(width, height);
+
+    layoutScene();
+}
+
+void StressScene::finish() {
+    vector<double> sorted = _frameTimes;
+    std::sort(sorted.begin(), sorted.end());
+
+    double total = 0;
+    for(double time : sorted)
+        total += time;
+
+    size_t frames = std::max<size_t>(sorted.size(), 1);
+
+    // Work done by the frames, and the atlases as of the end (built while setting the scene up, or on demand)
+    Statistics::Counters now = Statistics::snapshot();
+    Statistics::Counters counters = now - _initCounters;
+    Statistics::Counter perFrame[] = {Statistics::Relayouts, Statistics::Vertices, Statistics::BytesUploaded, Statistics::DrawCalls};
+
+    printf("{\n");
+    printf("  \"renderer\": \"%s\",\n", reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+    printf("  \"frames\": %zu,\n", sorted.size());
+    printf("  \"labels\": %zu,\n", _all.size());
+    printf("  \"frame_ms\": {\"mean\": %.3f, \"p50\": %.3f, \"p99\": %.3f, \"max\": %.3f},\n",
+           1e3 * total / frames, 1e3 * percentile(sorted, 0.5), 1e3 * percentile(sorted, 0.99),
+           sorted.empty() ? 0.0 : 1e3 * sorted.back());
+    printf("  \"cpu_ms_per_frame\": {\"layout\": %.3f, \"upload\": %.3f, \"draw\": %.3f},\n",
+           1e3 * _layoutTime / frames, 1e3 * _uploadTime / frames, 1e3 * _drawTime / frames);
+    printf("  \"draw_calls\": {\"total\": %lld, \"per_frame\": %.1f},\n",
+           static_cast<long long>(counters[Statistics::DrawCalls]),
+           static_cast<double>(counters[Statistics::DrawCalls]) / frames);
+
+    printf("  \"per_frame\": {");
+    for(size_t i = 0; i < sizeof(perFrame) / sizeof(perFrame[0]); ++i) {
+        printf("%s\"%s\": %.1f", i ? ", " : "", Statistics::getName(perFrame[i]),
+               static_cast<double>(counters[perFrame[i]]) / frames);
+    }
+    printf("},\n");
+
+    if(_gpuTiming)
+        printf("  \"gpu_ms_per_frame\": %.3f,\n", 1e-6 * counters[Statistics::GpuNanoseconds] / frames);
+
+    printf("  \"atlases\": {\"builds\": %lld, \"build_ms\": %.3f, \"texture_bytes\": %lld}\n",
+           static_cast<long long>(now[Statistics::AtlasBuilds]), 1e-6 * now[Statistics::AtlasBuildNanoseconds],
+           static_cast<long long>(now[Statistics::AtlasTextureBytes]));
+    printf("}\n");
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "OffscreenWindow.h"
+#include <GLFont/Statistics.h>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+using std::shared_ptr;
+using std::vector;
+
+class GLFont;
+class FTLabel;
+class FTFieldLabel;
+
+// Reproducible load for comparing library versions: thousands of static labels, a scrolling paragraph, numeric
+// fields changing every frame and a resize every ResizePeriod frames. Frame times and the CPU time spent laying out,
+// uploading and drawing are printed as JSON once all frames are drawn, with the library counters (see Statistics)
+class StressScene : public OffscreenWindow {
+public:
+    static const int ResizePeriod = 120;
+
+    // With gpuTiming, every label is timed on the GPU with timer queries
+    StressScene(int width, int height, int labelCount, bool gpuTiming = false);
+    ~StressScene();
+
+protected:
+    void init() override;
+    void update() override;
+    void render() override;
+    void finish() override;
+    void onResize(int width, int height) override;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    int _labelCount;
+    bool _gpuTiming;
+    int _initialWidth;
+    int _initialHeight;
+
+    shared_ptr<GLFont> _font;
+    vector<shared_ptr<FTLabel>> _labels;
+    shared_ptr<FTLabel> _paragraph;
+    vector<shared_ptr<FTFieldLabel>> _fields;
+    vector<FTLabel*> _all; // every label, in drawing order
+
+    // Measurements, in seconds
+    Clock::time_point _frameStart;
+    vector<double> _frameTimes;
+    double _layoutTime = 0;
+    double _uploadTime = 0;
+    double _drawTime = 0;
+    Statistics::Counters _initCounters; // library counters once the scene is set up
+
+    // Place the labels for the current window size
+    void layoutScene();
+};
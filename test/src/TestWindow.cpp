@@ -60,6 +60,13 @@ void TestWindow::onResize(int width, int height) {
 
     lblParagraph->setMaxSize(width, 0);
     lblParagraph->setPosition(0, 0.6 * height);
+
+    // Lay every label out again at once, in parallel
+    vector<FTLabel*> labels;
+    for(Label& label : _labels)
+        labels.push_back(label.get());
+    _layoutPool.update(labels);
+
     GLWindow::onResize(width, height);
 }
 
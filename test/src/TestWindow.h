@@ -1,6 +1,7 @@
 #pragma once
 
 #include "GLWindow.h"
+#include <GLFont/LayoutPool.h>
 #include <memory>
 #include <vector>
 
@@ -37,6 +38,7 @@ private:
     GLuint _vbo;
     shared_ptr<GLFont> _font;
     vector<Label> _labels;
+    LayoutPool _layoutPool;
 
     Label lblHello;
     Label lblParagraph;
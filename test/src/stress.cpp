@@ -0,0 +1,37 @@
+#include "StressScene.h"
+#include <cstring>
+#include <exception>
+
+int main(int argc, char** argv) {
+    int frames = 600;
+    int labels = 2000;
+    int width = 1280;
+    int height = 720;
+    bool gpuTiming = false;
+
+    for(int i = 1; i < argc; ++i) {
+        if(!strcmp(argv[i], "--gpu-timing"))
+            gpuTiming = true;
+        else if(i + 1 == argc)
+            break;
+        else if(!strcmp(argv[i], "--frames"))
+            frames = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--labels"))
+            labels = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--width"))
+            width = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--height"))
+            height = atoi(argv[++i]);
+    }
+
+    try {
+        StressScene scene(width, height, labels, gpuTiming);
+        scene.run(frames);
+    }
+    catch(const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
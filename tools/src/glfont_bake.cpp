@@ -0,0 +1,113 @@
+// Bakes the glyphs of a font at one pixel size into an atlas file, to be loaded with FontAtlas::load().
+// Runs FreeType only, no GL context is needed.
+
+#include <GLFont/GLFont.h>
+#include <GLFont/FontAtlas.h>
+#include <GLFont/Utf8.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static void printUsage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s <font file> <pixel size> <output file> [options]\n"
+            "Printable ASCII characters are always baked.\n"
+            "Options:\n"
+            "  --sdf               bake a distance field atlas, drawn sharp at any pixel size\n"
+            "  --chars <text>      also bake the characters of a UTF-8 string\n"
+            "  --chars-file <file> also bake the characters of a UTF-8 text file\n",
+            program);
+}
+
+static bool readFile(const std::string& path, std::string& contents) {
+    std::ifstream file(path, std::ios::binary);
+    if(!file)
+        return false;
+
+    std::stringstream stream;
+    stream << file.rdbuf();
+    contents = stream.str();
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if(argc < 4) {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::string fontFile = argv[1];
+    int pixelSize = atoi(argv[2]);
+    std::string outputFile = argv[3];
+    FontAtlas::RenderMode mode = FontAtlas::Bitmap;
+    std::string chars;
+
+    for(int i = 4; i < argc; ++i) {
+        if(!strcmp(argv[i], "--sdf")) {
+            mode = FontAtlas::DistanceField;
+        }
+        else if(!strcmp(argv[i], "--chars") && i + 1 < argc) {
+            chars += argv[++i];
+        }
+        else if(!strcmp(argv[i], "--chars-file") && i + 1 < argc) {
+            std::string contents;
+            if(!readFile(argv[++i], contents)) {
+                fprintf(stderr, "Failed to read %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+            chars += contents;
+        }
+        else {
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if(pixelSize <= 0) {
+        fprintf(stderr, "Invalid pixel size %s\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+
+    try {
+        GLFont font(fontFile);
+        FontAtlas atlas(font.getFaceHandle(), pixelSize, mode);
+
+        // Rasterize the extra characters in parallel, the ASCII ones are already in the atlas
+        std::set<uint32_t> codepoints;
+        for(uint32_t c = 32; c < 128; ++c)
+            codepoints.insert(c);
+
+        const char* p = chars.c_str();
+        for(uint32_t codepoint = Utf8::next(p); codepoint; codepoint = Utf8::next(p)) {
+            if(codepoint >= 128)
+                codepoints.insert(codepoint);
+        }
+        atlas.preload(std::vector<uint32_t>(codepoints.begin(), codepoints.end()));
+
+        // Look up the kerning of every pair involving an extra character, ASCII pairs are always baked
+        for(uint32_t left : codepoints) {
+            for(uint32_t right : codepoints) {
+                if(left >= 128 || right >= 128)
+                    atlas.getKerning(left, right);
+            }
+        }
+
+        atlas.save(outputFile);
+
+        printf("Baked %s at %d px into %s: %d page(s) of %dx%d\n", fontFile.c_str(), pixelSize, outputFile.c_str(),
+               atlas.getPageCount(), atlas.getAtlasWidth(), atlas.getAtlasHeight());
+    }
+    catch(const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}